@@ -0,0 +1,332 @@
+/**
+ * @file bench.cpp
+ * @brief Microbenchmarks of the decode and render path of the client.
+ *
+ * Every benchmark prints one JSON object per line on stdout, so the results can be collected and compared across
+ * releases, e.g. with jq:
+ * @code
+ * ./bench | tee bench.jsonl
+ * {"name":"codec.extract","iterations":16777216,"ns_per_op":1.92}
+ * @endcode
+ * The fields are the name of the benchmark, the number of operations timed, the mean time of one operation in
+ * nanoseconds, and extra counters specific to the benchmark. An argument only runs the benchmarks whose name contains it.
+ * The canvas is rendered into a QImage, Qt uses the offscreen platform unless QT_QPA_PLATFORM says otherwise.
+ */
+#include <QApplication>
+#include <QImage>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include "codec.h"
+#include "seqlock.h"
+#include "protocol.h"
+#include "options.h"
+#include "canvas.h"
+#include "tcpservice.h"
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    constexpr int SAMPLES{1024}; /**<The number of random frames the codec benchmarks cycle through*/
+
+    /**
+     * @brief Keeps the compiler from optimizing a value away.
+     * @param value The value.
+     */
+    template <typename T>
+    inline void keep(const T &value)
+    {
+        asm volatile("" : : "r,m"(value) : "memory");
+    }
+
+    /**
+     * @brief Returns the time elapsed since a start in nanoseconds.
+     * @param start The start.
+     * @return The time in nanoseconds.
+     */
+    double elapsed(Clock::time_point start)
+    {
+        return std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+    }
+
+    /**
+     * @brief Prints the result of a benchmark as a JSON line.
+     * @param name The name of the benchmark.
+     * @param iterations The number of operations timed.
+     * @param nanoseconds The total time of the operations.
+     * @param extra Extra fields, already formatted as JSON members starting with a comma.
+     */
+    void report(const char *name, uint64_t iterations, double nanoseconds, const std::string &extra = "")
+    {
+        std::printf("{\"name\":\"%s\",\"iterations\":%llu,\"ns_per_op\":%.2f%s}\n",
+                    name, static_cast<unsigned long long>(iterations), nanoseconds / iterations, extra.c_str());
+        std::fflush(stdout);
+    }
+
+    /**
+     * @brief Returns random frames, a fixed seed keeps the runs comparable.
+     * @return The frames.
+     */
+    std::vector<Codec::Frame> frames(void)
+    {
+        std::mt19937 random{42};
+        std::vector<Codec::Frame> result(SAMPLES);
+        for (Codec::Frame &frame : result)
+        {
+            for (uint8_t &byte : frame)
+            {
+                byte = static_cast<uint8_t>(random());
+            }
+        }
+        return result;
+    }
+
+    /**
+     * @brief Decodes every signal of a word, as the client does for a snapshot.
+     */
+    void extract(void)
+    {
+        constexpr uint64_t N{1 << 24};
+        std::vector<Codec::Word> words;
+        for (const Codec::Frame &frame : frames())
+        {
+            words.push_back(Codec::load(frame.data()));
+        }
+
+        auto start = Clock::now();
+        for (uint64_t i = 0; i < N; i++)
+        {
+            Codec::Word word = words[i % SAMPLES];
+            keep(Codec::get<Signal::Speed>(word));
+            keep(Codec::get<Signal::Temperature>(word));
+            keep(Codec::get<Signal::BatteryLevel>(word));
+            keep(Codec::get<Signal::LightLeft>(word));
+            keep(Codec::get<Signal::LightRight>(word));
+        }
+        report("codec.extract", N, elapsed(start));
+    }
+
+    /**
+     * @brief Encodes every signal into a word, as the server does for its sliders.
+     */
+    void insert(void)
+    {
+        constexpr uint64_t N{1 << 24};
+        std::vector<Codec::Frame> samples = frames();
+
+        auto start = Clock::now();
+        Codec::Word word{0};
+        for (uint64_t i = 0; i < N; i++)
+        {
+            const Codec::Frame &frame = samples[i % SAMPLES];
+            word = Codec::set<Signal::Speed>(word, frame[0] % (Signal::Speed::MAX + 1));
+            word = Codec::set<Signal::Temperature>(word, static_cast<int8_t>(frame[1]) % (Signal::Temperature::MAX + 1));
+            word = Codec::set<Signal::BatteryLevel>(word, frame[2] % (Signal::BatteryLevel::MAX + 1));
+            word = Codec::set<Signal::LightLeft>(word, frame[0] & 1);
+            word = Codec::set<Signal::LightRight>(word, frame[1] & 1);
+            keep(word);
+        }
+        report("codec.insert", N, elapsed(start));
+    }
+
+    /**
+     * @brief Validates packets and decodes every signal of their frame, the whole work of the client per packet.
+     */
+    void decode(void)
+    {
+        constexpr uint64_t N{1 << 22};
+        std::vector<Protocol::Packet> packets;
+        uint32_t sequence{0};
+        for (const Codec::Frame &frame : frames())
+        {
+            packets.emplace_back();
+            Protocol::encode(frame.data(), sequence++, Protocol::now(), 0, packets.back());
+        }
+
+        auto start = Clock::now();
+        for (uint64_t i = 0; i < N; i++)
+        {
+            const Protocol::Packet &packet = packets[i % SAMPLES];
+            Protocol::Header header;
+            Codec::Frame frame;
+            if (Protocol::decode(packet.data(), packet.size(), header, frame.data()) == Protocol::Result::Ok)
+            {
+                Codec::Word word = Codec::load(frame.data());
+                keep(Codec::get<Signal::Speed>(word));
+                keep(Codec::get<Signal::Temperature>(word));
+                keep(Codec::get<Signal::BatteryLevel>(word));
+                keep(Codec::get<Signal::LightLeft>(word));
+                keep(Codec::get<Signal::LightRight>(word));
+            }
+        }
+        report("frame.decode", N, elapsed(start));
+    }
+
+    /**
+     * @brief Reads and writes a frame through the seqlock from two threads and checks that no read is torn.
+     */
+    void seqlock(void)
+    {
+        constexpr auto DURATION = std::chrono::milliseconds(500);
+        SeqLock<Codec::Frame> lock;
+        std::atomic<bool> end{false};
+        uint64_t writes{0};
+
+        std::thread writer{[&]
+                           {
+                               for (uint8_t value = 0; !end; value++, writes++)
+                               {
+                                   lock.store(Codec::Frame{value, value, value});
+                               }
+                           }};
+
+        uint64_t reads{0};
+        uint64_t torn{0};
+        auto start = Clock::now();
+        while (Clock::now() - start < DURATION)
+        {
+            for (int i = 0; i < SAMPLES; i++, reads++)
+            {
+                Codec::Frame frame = lock.load();
+                torn += ((frame[0] != frame[1]) || (frame[1] != frame[2])) ? 1 : 0;
+            }
+        }
+        double time = elapsed(start);
+        end = true;
+        writer.join();
+
+        report("seqlock.load", reads, time, ",\"writes\":" + std::to_string(writes) + ",\"torn\":" + std::to_string(torn));
+    }
+
+    /**
+     * @brief Streams packets over loopback to the TCPService of the client and times until it accepted all of them.
+     */
+    void receive(void)
+    {
+        constexpr uint32_t N{200000};
+
+        int listener = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        sockaddr_in address{};
+        socklen_t length{sizeof(address)};
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if ((listener == -1) || (0 != bind(listener, reinterpret_cast<sockaddr *>(&address), sizeof(address))) ||
+            (0 != listen(listener, 1)) || (0 != getsockname(listener, reinterpret_cast<sockaddr *>(&address), &length)))
+        {
+            std::fprintf(stderr, "tcp.receive: cannot listen on the loopback\n");
+            return;
+        }
+
+        Options options;
+        options.host = "127.0.0.1";
+        options.tcpPort = ntohs(address.sin_port);
+
+        std::vector<uint8_t> stream(static_cast<size_t>(N) * Protocol::PACKET_SIZE);
+        std::vector<Codec::Frame> samples = frames();
+        for (uint32_t i = 0; i < N; i++)
+        {
+            Protocol::Packet packet;
+            Protocol::encode(samples[i % SAMPLES].data(), i, Protocol::now(), 0, packet);
+            std::memcpy(&stream[static_cast<size_t>(i) * Protocol::PACKET_SIZE], packet.data(), packet.size());
+        }
+
+        std::atomic<uint32_t> accepted{0};
+        TCPService service{options};
+        service.setObserver([&accepted](const Protocol::Header &, const Codec::Frame &)
+                            { accepted.fetch_add(1, std::memory_order_relaxed); });
+
+        int connection = accept(listener, nullptr, nullptr);
+        close(listener);
+        if (connection == -1)
+        {
+            std::fprintf(stderr, "tcp.receive: the client did not connect\n");
+            return;
+        }
+
+        auto start = Clock::now();
+        for (size_t sent = 0; sent < stream.size();)
+        {
+            ssize_t n = send(connection, stream.data() + sent, stream.size() - sent, MSG_NOSIGNAL);
+            if (n <= 0)
+            {
+                break;
+            }
+            sent += n;
+        }
+        while ((accepted.load(std::memory_order_relaxed) < N) && (Clock::now() - start < std::chrono::seconds(10)))
+        {
+            std::this_thread::yield();
+        }
+        double time = elapsed(start);
+        close(connection);
+
+        report("tcp.receive", N, time, ",\"accepted\":" + std::to_string(accepted.load()) + ",\"lost\":" + std::to_string(service.getLost()));
+    }
+
+    /**
+     * @brief Renders the whole canvas into an image with a new speed for every frame.
+     */
+    void render(void)
+    {
+        constexpr int N{500};
+        Canvas canvas;
+        canvas.resize(Setting::Client::Windows::Width, Setting::Client::Windows::Height);
+        canvas.setStatus(true);
+        canvas.setBatteryLevel(80);
+        canvas.setTemperature(21);
+
+        QImage image;
+        canvas.renderFrame(image); // The first frame builds the geometry and the dial layer
+
+        auto start = Clock::now();
+        for (int i = 0; i < N; i++)
+        {
+            canvas.setSpeed(i % (Signal::Speed::MAX + 1));
+            canvas.renderFrame(image);
+        }
+        report("canvas.render", N, elapsed(start), ",\"width\":" + std::to_string(image.width()) + ",\"height\":" + std::to_string(image.height()));
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM"))
+    {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+    QApplication app(argc, argv);
+
+    const std::string filter = (argc > 1) ? argv[1] : "";
+    const struct
+    {
+        const char *name;
+        void (*run)(void);
+    } benchmarks[]{
+        {"codec.extract", extract},
+        {"codec.insert", insert},
+        {"frame.decode", decode},
+        {"seqlock.load", seqlock},
+        {"tcp.receive", receive},
+        {"canvas.render", render},
+    };
+
+    for (const auto &benchmark : benchmarks)
+    {
+        if (std::string{benchmark.name}.find(filter) != std::string::npos)
+        {
+            benchmark.run();
+        }
+    }
+
+    return 0;
+}
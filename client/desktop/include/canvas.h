@@ -1,27 +1,111 @@
 #ifndef CANVAS_H
 #define CANVAS_H
 
+#include <QTimer>
+#include <QImage>
 #include <QWidget>
+#include <QPixmap>
 #include <QPainter>
 #include <QSoundEffect>
+#include <QStringList>
+#include <functional>
+#include "glyphcache.h"
 
 /**
  * @brief The Canvas class is a custom QWidget that displays various vehicle information.
  */
 class Canvas : public QWidget
 {
-    QPen drawPen;     /**< The pen used for drawing. */
-    QBrush brush;     /**< The brush used for drawing. */
-    QPainter painter; /**< The painter used for drawing. */
-    QFont iconFont;   /**< The font used for drawing icons. */
-
-    uint32_t batteryLevel{0};     /**< The current battery level. */
-    bool status{false};           /**< The current status of the vehicle. */
-    uint32_t speed{0};            /**< The current speed of the vehicle. */
-    int32_t temperature{0};       /**< The current temperature of the vehicle. */
-    bool leftLight{false};        /**< The current state of the left light. */
-    bool rightLight{false};       /**< The current state of the right light. */
-    QSoundEffect turnSignalSound; /**< The sound effect for the turn signal. */
+public:
+    /**
+     * @brief The texts shown instead of the speed while there is no signal.
+     */
+    enum class StatusText : quint32
+    {
+        NoSignal,  /**< No connection is being attempted. */
+        Connecting /**< A connection is being attempted. */
+    };
+
+private:
+    /**
+     * @brief The elements drawn through the glyph cache, their id is the element and the value shown.
+     */
+    enum class Element : quint32
+    {
+        Icon,        /**< The battery and temperature icons, by code point. */
+        Arrow,       /**< The arrows, by code point. */
+        SpeedIcon,   /**< The speedometer icons, by code point. */
+        Battery,     /**< The battery level text, by level. */
+        Temperature, /**< The temperature text, by temperature. */
+        Speed,       /**< The speed text, by speed. */
+        Status       /**< The status text, by StatusText. */
+    };
+
+    static constexpr int MAX_BLINK{14};    /**< The blink period in timer ticks. Higher values will result in slower blinking. */
+    static constexpr int GLYPH_MARGIN{15}; /**< The distance the arrow glyphs may overflow their rect. */
+
+    /**
+     * @brief A marking of the speedometer dial.
+     */
+    struct Marking
+    {
+        QLineF line; /**< The line of the marking. */
+        int width;   /**< The width of the marking in pixels. */
+    };
+
+    /**
+     * @brief A label of the speedometer dial.
+     */
+    struct Label
+    {
+        QPointF position; /**< The baseline position of the label. */
+        QString text;     /**< The text of the label. */
+    };
+
+    QPen drawPen;      /**< The pen used for drawing. */
+    QBrush brush;      /**< The brush used for drawing. */
+    QPainter painter;  /**< The painter used for drawing. */
+    QPixmap dialLayer; /**< The cached arc, markings and labels of the speedometer. */
+    GlyphCache glyphs; /**< The pre-rendered icons and texts. */
+
+    const QFont iconFont{"Material Icons", 50, QFont::Normal};  /**< The font used for drawing the battery and temperature icons. */
+    const QFont arrowFont{"Material Icons", 46, QFont::Normal}; /**< The font used for drawing the arrows. */
+    QFont speedIconFont{"Material Icons"};                      /**< The font used for drawing the speedometer icon. */
+    const QFont textFont{"Arial", 11};                          /**< The font used for drawing the battery and temperature texts. */
+    const QFont readoutFont{"Arial", 20, QFont::Normal};        /**< The font used for drawing the speed value text. */
+    QFont overlayFont{"Monospace", 9};                          /**< The fixed-pitch font used for drawing the debug overlay. */
+
+    QSize geometrySize;         /**< The size of the canvas the geometry was computed for. */
+    QVector<Marking> markings;  /**< The markings of the dial. */
+    QVector<Label> labels;      /**< The labels of the dial. */
+    QVector<QPolygonF> needles; /**< The needle polygon for every speed value. */
+
+    uint32_t batteryLevel{0};                    /**< The current battery level. */
+    bool status{false};                          /**< The current status of the vehicle. */
+    StatusText statusText{StatusText::NoSignal}; /**< The text shown instead of the speed while there is no signal. */
+    uint32_t speed{0};                           /**< The current speed of the vehicle. */
+    int32_t temperature{0};                      /**< The current temperature of the vehicle. */
+    bool leftLight{false};                       /**< The current state of the left light. */
+    bool rightLight{false};                      /**< The current state of the right light. */
+    QSoundEffect turnSignalSound;                /**< The sound effect for the turn signal. */
+    QTimer blinkTimer;                           /**< The timer driving the blinking of the arrows. */
+    int blink{0};                                /**< The blink counter of the arrows. */
+
+    const QColor staleColor{0x60, 0x60, 0x60}; /**< The color of the readings whose frames stopped arriving. */
+    bool batteryStale{false};                  /**< Whether the battery level is stale. */
+    bool temperatureStale{false};              /**< Whether the temperature is stale. */
+    bool speedStale{false};                    /**< Whether the speed is stale. */
+    bool leftLightStale{false};                /**< Whether the state of the left light is stale. */
+    bool rightLightStale{false};               /**< Whether the state of the right light is stale. */
+
+    QStringList overlay;               /**< The lines of the debug overlay, empty when it is hidden. */
+    std::function<void(void)> painted; /**< The callback invoked when a paint of the widget completed. */
+
+    const QRect batteryRect{680, 280, 100, 150};     /**< The region of the battery icon, bar and text. */
+    const QRect temperatureRect{680, 380, 100, 145}; /**< The region of the temperature icon and text. */
+    const QRect leftArrowRect{10, 5, 40, 40};        /**< The region of the left arrow. */
+    const QRect rightArrowRect{620, 5, 40, 40};      /**< The region of the right arrow. */
+    const QRect overlayRect{10, 50, 320, 128};       /**< The region of the debug overlay. */
 
 public:
     /**
@@ -34,36 +118,81 @@ public:
      * @brief Sets the battery level.
      * @param level The new battery level.
      */
-    void setBatteryLevel(uint32_t level) { batteryLevel = level; }
+    void setBatteryLevel(uint32_t level);
 
     /**
      * @brief Sets the temperature.
      * @param temp The new temperature.
      */
-    void setTemperature(int32_t temp) { temperature = temp; }
+    void setTemperature(int32_t temp);
 
     /**
      * @brief Sets the status.
      * @param sts The new status.
      */
-    void setStatus(bool sts) { status = sts; }
+    void setStatus(bool sts);
+
+    /**
+     * @brief Sets the text shown instead of the speed while there is no signal.
+     * @param text The new text, following the state of the connection.
+     */
+    void setStatusText(StatusText text);
 
     /**
      * @brief Sets the speed.
      * @param spd The new speed.
      */
-    void setSpeed(uint32_t spd) { speed = spd; }
+    void setSpeed(uint32_t spd);
 
     /**
      * @brief Sets the state of the lights.
      * @param left The state of the left light.
      * @param right The state of the right light.
      */
-    void setLight(bool left, bool right)
-    {
-        leftLight = left;
-        rightLight = right;
-    }
+    void setLight(bool left, bool right);
+
+    /**
+     * @brief Sets whether the battery level is stale, it is then greyed out.
+     * @param stale True if no frame arrived for too long.
+     */
+    void setBatteryStale(bool stale);
+
+    /**
+     * @brief Sets whether the temperature is stale, it is then greyed out.
+     * @param stale True if no frame arrived for too long.
+     */
+    void setTemperatureStale(bool stale);
+
+    /**
+     * @brief Sets whether the speed is stale, the needle and the readout are then greyed out.
+     * @param stale True if no frame arrived for too long.
+     */
+    void setSpeedStale(bool stale);
+
+    /**
+     * @brief Sets whether the state of the lights is stale, the arrows are then greyed out.
+     * @param left True if the state of the left light is stale.
+     * @param right True if the state of the right light is stale.
+     */
+    void setLightStale(bool left, bool right);
+
+    /**
+     * @brief Renders the whole canvas into an image, the canvas does not need to be shown.
+     * @param image The image, reallocated if it does not have the size of the canvas.
+     */
+    void renderFrame(QImage &image);
+
+    /**
+     * @brief Sets the lines of the debug overlay drawn over the canvas.
+     * @param lines The lines, or an empty list to hide the overlay.
+     */
+    void setOverlay(const QStringList &lines);
+
+    /**
+     * @brief Sets the callback invoked on the GUI thread when a paint of the widget completed.
+     * @param callback The callback, or nullptr to stop the calls.
+     */
+    void setPainted(std::function<void(void)> callback);
 
 private:
     /**
@@ -72,6 +201,69 @@ private:
      */
     void paintEvent(QPaintEvent *event) override;
 
+    /**
+     * @brief Paints the dirty region of the canvas on a device.
+     * @param device The widget itself or an image.
+     * @param dirty The region to repaint.
+     */
+    void paint(QPaintDevice *device, const QRegion &dirty);
+
+    /**
+     * @brief The resize event handler, invalidates the dial layer.
+     * @param event The resize event.
+     */
+    void resizeEvent(QResizeEvent *event) override;
+
+    /**
+     * @brief Renders the arc, markings and labels into the dial layer.
+     */
+    void renderDial(void);
+
+    /**
+     * @brief Returns the angle of the needle, only used to compute the needle table.
+     * @param value The speed the needle points to.
+     * @return The rotation of the needle in degrees.
+     */
+    qreal needleAngle(uint32_t value) const;
+
+    /**
+     * @brief Returns the region covered by the needle and the center circle.
+     * @param value The speed the needle points to.
+     * @return The bounding rectangle of the needle.
+     */
+    QRect needleRect(uint32_t value);
+
+    /**
+     * @brief Returns the precomputed needle polygon.
+     * @param value The speed the needle points to.
+     * @return The needle in canvas coordinates.
+     */
+    const QPolygonF &needle(uint32_t value);
+
+    /**
+     * @brief Computes the markings, labels and needles for the current size of the canvas.
+     */
+    void buildGeometry(void);
+
+    /**
+     * @brief Returns the region of the speedometer dial.
+     * @return The bounding rectangle of the arc, markings and labels.
+     */
+    QRect dialRect(void) const;
+
+    /**
+     * @brief Tells whether a region overlaps the circle of the dial, not only its bounding rectangle.
+     * @param region The region, e.g. the dirty region of a paint.
+     * @return true if the dial or the needle must be drawn again.
+     */
+    bool intersectsDial(const QRegion &region) const;
+
+    /**
+     * @brief Returns the region of the speed icon and the speed value text.
+     * @return The bounding rectangle of the readout.
+     */
+    QRect readoutRect(void) const;
+
     /**
      * @brief Draws the battery level.
      */
@@ -96,6 +288,11 @@ private:
      * @brief Draws the speedometer needle.
      */
     void drawSpeedometerNeedle(void);
+
+    /**
+     * @brief Draws the debug overlay.
+     */
+    void drawOverlay(void);
 };
 
 #endif // CANVAS_H
\ No newline at end of file
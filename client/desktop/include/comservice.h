@@ -3,35 +3,182 @@
 
 #include <mutex>
 #include <atomic>
+#include <memory>
 #include <cstdint>
+#include <functional>
 #include "setting.h"
+#include "codec.h"
+#include "seqlock.h"
+#include "options.h"
+#include "protocol.h"
+#include "metrics.h"
 #include <QObject>
 
+/**
+ * @brief The state of the connection to the vehicle.
+ */
+enum class State
+{
+    Disconnected, /**< The service is not connected and not trying to. */
+    Connecting,   /**< The service is trying to connect. */
+    Connected,    /**< The service receives frames. */
+    Backoff       /**< The service waits before the next attempt to connect. */
+};
+
+/**
+ * @brief The timestamps of the last change of the frame on its way from the setter of the server to the client.
+ *
+ * The change and send times are read on the clock of the server, the others on the clock of the client,
+ * so the transit between them is only meaningful when both share the monotonic clock, i.e. run on the same host.
+ */
+struct Trace
+{
+    uint64_t changed{0}; /**< The time the setter of the server changed the frame. */
+    uint64_t sent{0};    /**< The time the server sent the packet. */
+    uint64_t read{0};    /**< The time the client read the packet from the link, 0 without a trace. */
+    uint64_t decoded{0}; /**< The time the client decoded the packet and published its frame. */
+};
+
+/**
+ * @brief One value for every signal of the frame.
+ * @tparam T The type of the values.
+ */
+template <typename T>
+struct PerSignal
+{
+    T speed{};        /**< The value for the speed. */
+    T temperature{};  /**< The value for the temperature. */
+    T batteryLevel{}; /**< The value for the battery level. */
+    T lightLeft{};    /**< The value for the left light. */
+    T lightRight{};   /**< The value for the right light. */
+};
+
+/**
+ * @brief The monotonic times on the clock of the client at which the frame and each of its signals were last renewed.
+ *
+ * Every frame carries every signal, so a signal is as fresh as the last frame that arrived, the change times tell
+ * since when a signal holds its value.
+ */
+struct Freshness
+{
+    uint64_t arrived{0};         /**< The time the last frame was published in microseconds, 0 before the first one. */
+    PerSignal<uint64_t> changed; /**< The time each signal last changed its value in microseconds, 0 before the first change. */
+};
+
+/**
+ * @brief The decoded values of one frame.
+ */
+struct Snapshot
+{
+    bool status{false};               /**< The status of the service when the frame was taken. */
+    State state{State::Disconnected}; /**< The state of the connection when the frame was taken. */
+    uint32_t speed{0};                /**< The speed of the vehicle. */
+    int32_t temperature{0};           /**< The temperature of the vehicle. */
+    uint32_t batteryLevel{0};         /**< The battery level of the vehicle. */
+    bool lightLeft{false};            /**< The status of the left light of the vehicle. */
+    bool lightRight{false};           /**< The status of the right light of the vehicle. */
+    Trace trace;                      /**< The timestamps of the last change of a decoded value. */
+    Freshness freshness;              /**< The arrival time of the frame and the change time of every signal. */
+    PerSignal<bool> stale;            /**< True for every signal whose last frame is older than its threshold. */
+    int nextStale{0};                 /**< The time until the next fresh signal turns stale in milliseconds, 0 if none is fresh. */
+};
+
 /**
  * @brief The COMService class is a base class for services that communicate with the vehicle.
  */
 class COMService : public QObject
 {
+public:
+    using Observer = std::function<void(const Protocol::Header &, const Codec::Frame &)>; /**< Callback receiving every packet accepted. */
+
+private:
     /**
-     * @brief Extracts a value from the buffer.
-     * @param start The starting index of the value in the buffer.
-     * @param length The length of the value in bits.
-     * @param value The extracted value.
+     * @brief Loads the buffer as a word.
+     * @return The word holding the whole frame.
      */
-    void extract(uint32_t start, uint32_t length, uint32_t &value);
+    Codec::Word load(void);
 
     /**
-     * @brief Extracts a value from the buffer.
-     * @param start The starting index of the value in the buffer.
-     * @param length The length of the value in bits.
-     * @param value The extracted value.
+     * @brief Calls the notifier unless a notification is already pending.
      */
-    void extract(uint32_t start, uint32_t length, int32_t &value);
+    void notify(void);
+
+    std::mutex notifierMtx;             /**< Mutex to protect the notifier, taken only when something changed. */
+    std::function<void(void)> notifier; /**< Callback invoked from the I/O thread when a decoded value or the status changed. */
+    std::atomic<bool> pending{false};   /**< Atomic boolean to indicate that a notification has not been acknowledged yet. */
+    Codec::Word last{0};                /**< The last word published, accessed by the I/O thread only. */
+    uint32_t expected{0};               /**< The sequence number expected next, accessed by the I/O thread only. */
+    bool synced{false};                 /**< True once a packet was received since the link came up, accessed by the I/O thread only. */
+    bool connectedOnce{false};          /**< True once the link was up, so the next time it comes up is a reconnect, accessed by the I/O thread only. */
+    Trace candidate;                    /**< The trace of the last packet accepted, accessed by the I/O thread only. */
+    SeqLock<Trace> traced;              /**< The trace of the last frame that changed a decoded value, stored before the frame. */
+    Freshness fresh;                    /**< The arrival and change times, accessed by the I/O thread only. */
+    SeqLock<Freshness> freshness;       /**< The arrival and change times of the frame, stored before the frame. */
+
+    const PerSignal<uint64_t> staleness; /**< The time without any frame after which each signal is stale in microseconds. */
+    const uint64_t revival;              /**< The smallest staleness, a frame arriving later may turn a stale signal fresh. */
+
+    std::atomic<int64_t> latency{0}; /**< The latency of the last packet in microseconds. */
+
+    std::mutex observerMtx;            /**< Mutex to protect the observer. */
+    Observer observer;                 /**< Callback invoked from the I/O thread for every packet accepted, e.g. a logger. */
+    std::atomic<bool> observed{false}; /**< True while an observer is set, so the mutex is skipped otherwise. */
 
 protected:
-    std::mutex mtx;                              /**< Mutex to protect the buffer. */
-    std::atomic<bool> status{false};             /**< Atomic boolean to indicate the status of the service. */
-    uint8_t Buffer[Setting::Signal::BUFSIZE]{0}; /**< Buffer to store the data received from the vehicle. */
+    std::atomic<bool> status{false};               /**< Atomic boolean to indicate the status of the service. */
+    std::atomic<State> state{State::Disconnected}; /**< The state of the connection, status is true only when connected. */
+    SeqLock<Codec::Frame> Buffer;                  /**< Buffer to store the data received from the vehicle, written by the I/O thread only. */
+    Metrics::Registry metrics;                     /**< The health of the link, counted by the I/O thread and read from any thread. */
+
+    /**
+     * @brief Constructs the service with the staleness thresholds of the options.
+     * @param options The options parsed at startup.
+     */
+    explicit COMService(const Options &options);
+
+    /**
+     * @brief Publishes a frame received from the vehicle and notifies if any decoded value changed.
+     * @param frame The frame received.
+     */
+    void publish(const Codec::Frame &frame);
+
+    /**
+     * @brief Checks the sequence number of a packet and hands it to the observer.
+     *
+     * Services that receive several packets at once accept each of them and only publish the newest frame.
+     *
+     * @param header The header of the packet received.
+     * @param frame The frame carried by the packet.
+     * @param read The monotonic time the packet was read from the link in microseconds.
+     * @return true if the packet is the newest so far, false if it arrived late and must be discarded.
+     */
+    bool accept(const Protocol::Header &header, const Codec::Frame &frame, uint64_t read);
+
+    /**
+     * @brief Checks the sequence number of a packet and publishes its frame unless it arrived late.
+     * @param header The header of the packet received.
+     * @param frame The frame carried by the packet.
+     * @param read The monotonic time the packet was read from the link in microseconds.
+     */
+    void publish(const Protocol::Header &header, const Codec::Frame &frame, uint64_t read);
+
+    /**
+     * @brief Counts a packet that failed to decode.
+     * @param result The reason, anything but Ok.
+     */
+    void reject(Protocol::Result result);
+
+    /**
+     * @brief Sets the status of the service and notifies if it changed.
+     * @param value The new status.
+     */
+    void setStatus(bool value);
+
+    /**
+     * @brief Sets the state of the connection, updates the status and notifies if either changed.
+     * @param value The new state.
+     */
+    void setState(State value);
 
     /**
      * @brief The run method is a pure virtual method that must be implemented by the derived classes.
@@ -45,6 +192,47 @@ public:
      */
     bool getStatus(void) { return status; }
 
+    /**
+     * @brief Returns the state of the connection.
+     * @return The state of the connection.
+     */
+    State getState(void) { return state; }
+
+    /**
+     * @brief Sets the callback invoked from the I/O thread when a decoded value or the status changed.
+     *
+     * Notifications are coalesced, the callback is not invoked again until acknowledge() is called.
+     * The callback is invoked once right away so that the current state is shown.
+     *
+     * @param callback The callback, or nullptr to stop the notifications.
+     */
+    void setNotifier(std::function<void(void)> callback);
+
+    /**
+     * @brief Sets the callback invoked from the I/O thread for every packet accepted, not only the newest one.
+     * @param callback The callback, or nullptr to stop the calls.
+     */
+    void setObserver(Observer callback);
+
+    /**
+     * @brief Acknowledges the pending notification, must be called before taking the snapshot.
+     */
+    void acknowledge(void) { pending = false; }
+
+    /**
+     * @brief Returns the value of a signal.
+     * @tparam S The descriptor of the signal, e.g. Signal::Speed.
+     * @return The value of the signal.
+     */
+    template <typename S>
+    typename S::type get(void) { return Codec::get<S>(load()); }
+
+    /**
+     * @brief Returns all signals decoded from the same frame.
+     * @return The snapshot of the frame, the buffer is read once.
+     */
+    Snapshot snapshot(void);
+
     /**
      * @brief Returns the speed of the vehicle.
      * @return The speed of the vehicle.
@@ -75,6 +263,37 @@ public:
      */
     bool getLightRight(void);
 
+    /**
+     * @brief Returns the number of packets missing in the sequence since the start.
+     * @return The number of packets lost.
+     */
+    uint32_t getLost(void) { return static_cast<uint32_t>(metrics.get(Metrics::PacketsLost)); }
+
+    /**
+     * @brief Returns the number of packets received late or twice since the start.
+     * @return The number of packets reordered.
+     */
+    uint32_t getReordered(void) { return static_cast<uint32_t>(metrics.get(Metrics::PacketsReordered)); }
+
+    /**
+     * @brief Returns the latency of the last packet, only meaningful when the server runs on the same host.
+     * @return The latency in microseconds.
+     */
+    int64_t getLatency(void) { return latency; }
+
+    /**
+     * @brief Returns the health of the link, the counters can be read from any thread without a lock.
+     * @return The metrics of the transport.
+     */
+    const Metrics::Registry &getMetrics(void) const { return metrics; }
+
+    /**
+     * @brief Creates the transport chosen in the options, its thread starts right away.
+     * @param options The options parsed at startup.
+     * @return The service.
+     */
+    static std::unique_ptr<COMService> create(const Options &options);
+
     /**
      * @brief The destructor of the COMService class.
      */
@@ -0,0 +1,158 @@
+#ifndef GLYPHCACHE_H
+#define GLYPHCACHE_H
+
+#include <QHash>
+#include <QCache>
+#include <QFont>
+#include <QColor>
+#include <QPixmap>
+#include <QPainter>
+#include <QPaintDevice>
+
+/**
+ * @brief The GlyphCache class keeps pre-rendered pixmaps of icons and strings.
+ *
+ * A text is rendered once per id, color and device pixel ratio, so painting it again only blits a pixmap
+ * and text layout and font matching stay out of the paint path. The caller names every text with an id, built
+ * from the element drawn and the value it shows, and only builds the text itself when it is not cached yet,
+ * so a draw that hits the cache allocates nothing.
+ */
+class GlyphCache
+{
+public:
+    static constexpr int CAPACITY{512}; /**< The maximum number of pre-rendered texts, the least recently used is dropped beyond. */
+
+private:
+    /**
+     * @brief A pre-rendered text.
+     */
+    struct Glyph
+    {
+        QPixmap pixmap; /**< The rendered text, the size of its logical bounding box. */
+        int ascent{0};  /**< The distance from the top of the pixmap to the baseline. */
+    };
+
+    /**
+     * @brief The key of a pre-rendered text.
+     */
+    struct Key
+    {
+        quint64 id;  /**< The id of the text, which also stands for its font. */
+        QRgb color;  /**< The color of the text. */
+        qreal ratio; /**< The device pixel ratio of the target. */
+
+        bool operator==(const Key &other) const { return (id == other.id) && (color == other.color) && (ratio == other.ratio); }
+
+        friend size_t qHash(const Key &key, size_t seed = 0) { return qHashMulti(seed, key.id, key.color, key.ratio); }
+    };
+
+    QCache<Key, Glyph> glyphs{CAPACITY}; /**< The rendered texts, each one costs 1. */
+
+    /**
+     * @brief Renders a text and caches it.
+     * @param key The key of the text.
+     * @param text The text.
+     * @param font The font.
+     * @param color The color.
+     * @return The pre-rendered text.
+     */
+    const Glyph &render(const Key &key, const QString &text, const QFont &font, const QColor &color);
+
+    /**
+     * @brief Returns the pre-rendered text, rendering it on the first use.
+     * @param painter The painter, for the device pixel ratio.
+     * @param id The id of the text.
+     * @param text The callable returning the text, only invoked on a miss.
+     * @param font The font.
+     * @param color The color.
+     * @return The pre-rendered text.
+     */
+    template <typename Text>
+    const Glyph &glyph(QPainter &painter, quint64 id, Text &text, const QFont &font, const QColor &color)
+    {
+        const Key key{id, color.rgba(), painter.device()->devicePixelRatioF()};
+        const Glyph *entry = glyphs.object(key);
+
+        return (entry != nullptr) ? *entry : render(key, text(), font, color);
+    }
+
+    /**
+     * @brief Blits a pre-rendered text centered in a rectangle.
+     * @param painter The painter.
+     * @param rect The rectangle.
+     * @param entry The pre-rendered text.
+     */
+    static void blit(QPainter &painter, const QRect &rect, const Glyph &entry);
+
+    /**
+     * @brief Blits a pre-rendered text with its baseline starting at a point.
+     * @param painter The painter.
+     * @param x The X-coordinate of the start of the baseline.
+     * @param y The Y-coordinate of the baseline.
+     * @param entry The pre-rendered text.
+     */
+    static void blit(QPainter &painter, int x, int y, const Glyph &entry);
+
+public:
+    /**
+     * @brief Builds the id of a text from the element drawn and the value it shows.
+     * @param element The element, a scoped enumeration of the caller.
+     * @param value The value shown, e.g. a reading or a code point.
+     * @return The id.
+     */
+    template <typename Element>
+    static constexpr quint64 id(Element element, quint32 value) { return (static_cast<quint64>(element) << 32) | value; }
+
+    /**
+     * @brief Draws a text centered in a rectangle, like QPainter::drawText with Qt::AlignCenter.
+     * @param painter The painter.
+     * @param rect The rectangle.
+     * @param id The id of the text, the same id must always give the same text and font.
+     * @param text The callable returning the text, only invoked on a miss.
+     * @param font The font.
+     * @param color The color.
+     */
+    template <typename Text>
+    void draw(QPainter &painter, const QRect &rect, quint64 id, Text text, const QFont &font, const QColor &color)
+    {
+        blit(painter, rect, glyph(painter, id, text, font, color));
+    }
+
+    /**
+     * @brief Draws a text with its baseline starting at a point, like QPainter::drawText with a position.
+     * @param painter The painter.
+     * @param x The X-coordinate of the start of the baseline.
+     * @param y The Y-coordinate of the baseline.
+     * @param id The id of the text, the same id must always give the same text and font.
+     * @param text The callable returning the text, only invoked on a miss.
+     * @param font The font.
+     * @param color The color.
+     */
+    template <typename Text>
+    void draw(QPainter &painter, int x, int y, quint64 id, Text text, const QFont &font, const QColor &color)
+    {
+        blit(painter, x, y, glyph(painter, id, text, font, color));
+    }
+
+    /**
+     * @brief Draws an icon centered in a rectangle, its id is the element and the code point.
+     * @param painter The painter.
+     * @param rect The rectangle.
+     * @param element The element, a scoped enumeration of the caller.
+     * @param icon The code point of the icon.
+     * @param font The font.
+     * @param color The color.
+     */
+    template <typename Element>
+    void drawIcon(QPainter &painter, const QRect &rect, Element element, QChar icon, const QFont &font, const QColor &color)
+    {
+        draw(painter, rect, id(element, icon.unicode()), [icon] { return QString(icon); }, font, color);
+    }
+
+    /**
+     * @brief Drops every pre-rendered text.
+     */
+    void clear(void) { glyphs.clear(); }
+};
+
+#endif // GLYPHCACHE_H
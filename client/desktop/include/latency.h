@@ -0,0 +1,147 @@
+#ifndef LATENCY_H
+#define LATENCY_H
+
+#include <array>
+#include <cstdint>
+#include <QString>
+#include <QStringList>
+#include "comservice.h"
+
+/**
+ * @brief The Histogram class counts durations in logarithmic buckets of bounded relative error.
+ *
+ * Every power of two is split into SUB_COUNT buckets, so a percentile is exact below SUB_COUNT and within
+ * 1 / SUB_COUNT of the true value above, from microseconds to hours, in a fixed array without any allocation.
+ */
+class Histogram
+{
+public:
+    static constexpr int SUB_BITS{3};                              /**< The number of bits resolved within a power of two. */
+    static constexpr int SUB_COUNT{1 << SUB_BITS};                 /**< The number of buckets per power of two. */
+    static constexpr int BUCKETS{(64 - SUB_BITS + 1) * SUB_COUNT}; /**< The number of buckets covering every 64-bit value. */
+
+private:
+    std::array<uint64_t, BUCKETS> counts{}; /**< The number of values in every bucket. */
+    uint64_t total{0};                      /**< The number of values. */
+    uint64_t maximum{0};                    /**< The largest value, exact. */
+
+public:
+    /**
+     * @brief Returns the bucket of a value.
+     * @param value The value.
+     * @return The index of the bucket.
+     */
+    static int index(uint64_t value);
+
+    /**
+     * @brief Returns the largest value of a bucket.
+     * @param index The index of the bucket.
+     * @return The upper bound of the bucket, inclusive.
+     */
+    static uint64_t upper(int index);
+
+    /**
+     * @brief Counts a value.
+     * @param value The value.
+     */
+    void add(uint64_t value);
+
+    /**
+     * @brief Returns the number of values in a bucket.
+     * @param index The index of the bucket.
+     * @return The number of values.
+     */
+    uint64_t at(int index) const { return counts[index]; }
+
+    /**
+     * @brief Returns the number of values.
+     * @return The number of values.
+     */
+    uint64_t count(void) const { return total; }
+
+    /**
+     * @brief Returns the largest value.
+     * @return The largest value, 0 without any value.
+     */
+    uint64_t max(void) const { return maximum; }
+
+    /**
+     * @brief Returns the value below which a fraction of the values fall.
+     * @param fraction The fraction, e.g. 0.99 for the 99th percentile.
+     * @return The upper bound of the bucket holding the percentile, at most the largest value.
+     */
+    uint64_t percentile(double fraction) const;
+};
+
+/**
+ * @brief The Latency class collects the end-to-end latency of the frames, from the setter of the server to the canvas.
+ *
+ * Every change shown on the canvas is split into stages, each one with its own histogram in microseconds.
+ * The transit and the total need the server and the client to share the monotonic clock, they are only
+ * counted when the transit is plausible, i.e. not negative and shorter than the timeout of the connection.
+ */
+class Latency
+{
+public:
+    /**
+     * @brief The stages of a frame.
+     */
+    enum Stage
+    {
+        Server,  /**< From the setter to the packet written to the link, on the server. */
+        Transit, /**< From the packet written to the packet read by the client. */
+        Decode,  /**< From the packet read to its frame published. */
+        Refresh, /**< From the frame published to the canvas updated on the GUI thread. */
+        Paint,   /**< From the canvas updated to its paint completed. */
+        Total,   /**< From the setter to the paint completed. */
+        STAGES   /**< The number of stages. */
+    };
+
+private:
+    std::array<Histogram, STAGES> histograms; /**< The durations of every stage. */
+    const uint64_t plausible;                 /**< The longest transit counted in microseconds, the timeout of the connection. */
+
+public:
+    /**
+     * @brief Constructs the histograms, empty.
+     * @param timeout The timeout of the connection in milliseconds, no packet travels longer.
+     */
+    explicit Latency(int timeout) : plausible{static_cast<uint64_t>(timeout) * 1000} {}
+
+    /**
+     * @brief Returns the name of a stage.
+     * @param stage The stage.
+     * @return The name, e.g. "transit".
+     */
+    static const char *name(Stage stage);
+
+    /**
+     * @brief Counts the stages of a frame shown on the canvas.
+     * @param trace The timestamps taken by the server and the transport.
+     * @param refreshed The monotonic time the canvas was updated in microseconds.
+     * @param painted The monotonic time the paint completed in microseconds.
+     */
+    void add(const Trace &trace, uint64_t refreshed, uint64_t painted);
+
+    /**
+     * @brief Returns the histogram of a stage.
+     * @param stage The stage.
+     * @return The histogram.
+     */
+    const Histogram &histogram(Stage stage) const { return histograms[stage]; }
+
+    /**
+     * @brief Returns one line per stage with the number of samples, the median, the 99th percentile and the maximum.
+     * @return The lines, the first one names the columns.
+     */
+    QStringList summary(void) const;
+
+    /**
+     * @brief Writes every stage as a JSON line, with its percentiles and its non-empty buckets.
+     * @param path The path of the file, it is replaced.
+     * @return true if the file was written.
+     */
+    bool dump(const QString &path) const;
+};
+
+#endif // LATENCY_H
@@ -0,0 +1,65 @@
+#ifndef SHMSERVICE_H
+#define SHMSERVICE_H
+#include <mutex>
+#include <thread>
+#include "comservice.h"
+#include "options.h"
+#include "shmring.h"
+
+/**
+ * @brief The SHMService class is a COMService that reads the frames of a server on the same host from shared memory.
+ *
+ * The thread sleeps on the doorbell of the ring and reads every packet written since it last woke up, see shmring.h.
+ * The server repeats the frame every heartbeat, so nothing written within the timeout means the server is gone,
+ * the object is then mapped again as a restarted server creates a new one.
+ */
+class SHMService : public COMService /**<Declares a new class named "SHMService" that inherits from "COMService".*/
+{
+private:
+    const Options options;            /**<The name of the shared memory object and the heartbeat, declared before the thread that reads them.*/
+    std::mutex mtx;                   /**<Mutex to protect the mapping, the destructor rings the doorbell while it is mapped.*/
+    ShmRing::Region *region{nullptr}; /**<The mapped ring, nullptr while the server is not running.*/
+    std::atomic<bool> end{false};     /**< Atomic flag to indicate when the service should stop.*/
+
+    /**
+     * @brief Defines a thread that runs the "run" function upon creation of a SHMService object.
+     */
+    std::thread thrd{&SHMService::run, this};
+
+    /**
+     * @brief Declaration of the overriden "run" function which is expected to provide the main functionality.
+     */
+    void run(void) override;
+
+    /**
+     * @brief Reads the ring until the server is silent for too long or the service is stopped.
+     */
+    void receive(void);
+
+public:
+    /**
+     * @brief Constructor declaration, the thread starts right away with the given options.
+     * @param opts The options.
+     */
+    explicit SHMService(const Options &opts) : COMService{opts}, options{opts} {}
+
+    /**
+     *@brief Destructor declaration.
+     * It ensures that when a SHMService object is destroyed,
+     * the thread is woken up and joined, the thread unmaps the ring before it returns.
+     */
+    ~SHMService()
+    {
+        {
+            std::scoped_lock<std::mutex> locker{mtx};
+            end = true;
+            if (region != nullptr)
+            {
+                region->doorbell.fetch_add(1); /**<The other readers wake up for nothing, the writer is not affected.*/
+                ShmRing::wake(*region);
+            }
+        }
+        thrd.join();
+    }
+};
+#endif
@@ -2,17 +2,28 @@
 #define TCPSERVICE_H
 #include <unistd.h>
 #include "comservice.h"
+#include "options.h"
 #include <sys/socket.h>
+#include <sys/eventfd.h>
+#include <netinet/in.h>
 #include <thread>
 
 /**
  * @brief The TCPService class is a COMService that communicates with the vehicle via TCP.
+ *
+ * The connection is a state machine driven by poll on a non-blocking socket: connecting, connected, and waiting
+ * with an exponential backoff after a failure. Connecting and reading are bounded by the timeout of the options,
+ * the destructor wakes the thread up through an eventfd.
  */
 class TCPService : public COMService /**<Declares a new class named "TCPService" that inherits from "COMService".*/
 {
 private:
-    int socket_fd;                /**<File descriptor for the TCP socket.*/
-    std::atomic<bool> end{false}; /**< Atomic flag to indicate when the service should stop.*/
+    static constexpr size_t RECV_SIZE{4096}; /**<The size of the receive buffer, a single recv takes up to this many bytes.*/
+
+    const Options options;                                /**<The address, port and heartbeat, declared before the thread that reads them.*/
+    int socket_fd{-1};                                    /**<File descriptor for the TCP socket.*/
+    int event_fd{eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)}; /**<File descriptor written by the destructor to wake up the thread.*/
+    std::atomic<bool> end{false};                         /**< Atomic flag to indicate when the service should stop.*/
 
     /**
      * @brief Defines a thread that runs the "run" function upon creation of a TCPService object.
@@ -24,23 +35,49 @@ private:
      */
     void run(void) override;
 
+    /**
+     * @brief Waits until the socket is ready, the timeout expires or the service is stopped.
+     * @param events The poll events to wait for on the socket, or 0 to only wait for the timeout.
+     * @param timeout The timeout in milliseconds.
+     * @return The poll events returned for the socket, 0 on timeout or when the service is stopped.
+     */
+    short await(short events, int timeout);
+
+    /**
+     * @brief Connects the socket to the server within the timeout.
+     * @param address The address of the server.
+     * @return true if the connection is established.
+     */
+    bool open(const sockaddr_in &address);
+
+    /**
+     * @brief Receives packets in batches until the connection is lost, times out or the service is stopped.
+     * @return true if at least one valid packet was received.
+     */
+    bool receive(void);
+
 public:
     /**
-     * @brief Constructor declaration.
+     * @brief Constructor declaration, the thread starts right away with the given options.
+     * @param opts The options.
      */
-    TCPService() = default;
+    explicit TCPService(const Options &opts) : COMService{opts}, options{opts} {}
 
     /**
      *@brief Destructor declaration.
      * It ensures that when a TCPService object is destroyed,
-     * The socket is shutdown and closed, and the associated thread is joined.
+     * the thread is woken up and joined, the thread closes the socket before it returns.
      */
     ~TCPService()
     {
+        uint64_t one{1};
         end = true;
-        shutdown(socket_fd, SHUT_RDWR);
-        close(socket_fd);
+        if (sizeof(one) != write(event_fd, &one, sizeof(one)))
+        {
+            shutdown(socket_fd, SHUT_RDWR);
+        }
         thrd.join();
+        close(event_fd);
     }
 };
 #endif
@@ -2,6 +2,7 @@
 #define UARTSERVICE_H
 
 #include "comservice.h"
+#include "options.h"
 #include <QThread>
 
 /**
@@ -10,14 +11,16 @@
 class UARTService : public COMService, public QThread
 {
     std::atomic<bool> end{false}; /**< Flag to indicate when the thread should end. */
+    const Options options;        /**< The serial port, e.g. a pty standing in for the ESP32, the baud rate and the heartbeat. */
 
     void run(void) override; /**< Overriden run function that provides the main functionality of the thread. */
 
 public:
     /**
      * @brief Constructor declaration.
+     * @param opts The options.
      */
-    UARTService()
+    explicit UARTService(const Options &opts) : COMService{opts}, options{opts}
     {
         start();
     };
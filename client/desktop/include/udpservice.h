@@ -0,0 +1,72 @@
+#ifndef UDPSERVICE_H
+#define UDPSERVICE_H
+#include <unistd.h>
+#include "comservice.h"
+#include "options.h"
+#include <sys/socket.h>
+#include <sys/eventfd.h>
+#include <thread>
+
+/**
+ * @brief The UDPService class is a COMService that subscribes to the frames published by the server via UDP.
+ *
+ * The socket joins the multicast group given in the options, any number of clients can listen at once.
+ * The server sends at least every heartbeat, so nothing received within the timeout means the server is gone.
+ * The destructor wakes the thread up through an eventfd.
+ */
+class UDPService : public COMService /**<Declares a new class named "UDPService" that inherits from "COMService".*/
+{
+private:
+    static constexpr int BATCH{64}; /**<The maximum number of datagrams taken by a single recvmmsg.*/
+
+    const Options options;                                /**<The group, interface, port and heartbeat, declared before the thread that reads them.*/
+    int socket_fd{-1};                                    /**<File descriptor for the UDP socket.*/
+    int event_fd{eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)}; /**<File descriptor written by the destructor to wake up the thread.*/
+    std::atomic<bool> end{false};                         /**< Atomic flag to indicate when the service should stop.*/
+
+    /**
+     * @brief Defines a thread that runs the "run" function upon creation of a UDPService object.
+     */
+    std::thread thrd{&UDPService::run, this};
+
+    /**
+     * @brief Declaration of the overriden "run" function which is expected to provide the main functionality.
+     */
+    void run(void) override;
+
+    /**
+     * @brief Creates the socket, binds it to the port and joins the multicast group.
+     * @return true if the socket is ready to receive.
+     */
+    bool open(void);
+
+    /**
+     * @brief Receives datagrams in batches until the server is silent for too long, the socket fails or the service is stopped.
+     */
+    void receive(void);
+
+public:
+    /**
+     * @brief Constructor declaration, the thread starts right away with the given options.
+     * @param opts The options.
+     */
+    explicit UDPService(const Options &opts) : COMService{opts}, options{opts} {}
+
+    /**
+     *@brief Destructor declaration.
+     * It ensures that when a UDPService object is destroyed,
+     * the thread is woken up and joined, the thread closes the socket before it returns.
+     */
+    ~UDPService()
+    {
+        uint64_t one{1};
+        end = true;
+        if (sizeof(one) != write(event_fd, &one, sizeof(one)))
+        {
+            shutdown(socket_fd, SHUT_RDWR);
+        }
+        thrd.join();
+        close(event_fd);
+    }
+};
+#endif
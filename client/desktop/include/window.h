@@ -2,10 +2,12 @@
 #define WINDOW_H
 
 #include <QTimer>
+#include <QElapsedTimer>
 #include "canvas.h"
 #include <QDialog>
 #include <QGridLayout>
 #include "comservice.h"
+#include "latency.h"
 
 /**
  * @class Window
@@ -13,22 +15,67 @@
  */
 class Window : public QDialog
 {
-    QTimer timer;                       /**< Timer used to refresh the canvas periodically. */
+    QTimer timer;                       /**< Timer used to delay a refresh that would exceed the maximum frame rate. */
+    QTimer staleTimer;                  /**< Timer refreshing the canvas when the next signal turns stale, no frame arrives to do it. */
+    QElapsedTimer elapsed;              /**< Time elapsed since the last refresh. */
+    const int frameInterval;            /**< The minimum time between two refreshes in milliseconds, from the maximum frame rate. */
     Canvas canvas;                      /**< Canvas used for drawing. */
     QGridLayout layout;                 /**< Layout used to organize the widgets in the window. */
     COMService *communication{nullptr}; /**< Pointer to the COMService object used for communication with the vehicle. */
 
+    Latency latency;          /**< The latency of the changes shown, from the setter of the server to the paint. */
+    Trace pending;            /**< The trace of the change refreshed but not painted yet. */
+    uint64_t refreshed{0};    /**< The time the pending change was refreshed, 0 when nothing is pending. */
+    uint64_t lastDecoded{0};  /**< The decode time of the last trace taken, a trace is only counted once. */
+    bool overlayShown{false}; /**< Whether the latency overlay is shown, toggled with F3. */
+    QElapsedTimer overlayAge; /**< Time elapsed since the overlay was last updated. */
+
 public:
     /**
      * @brief Constructs a new Window object.
+     * @param com The transport the values are taken from.
+     * @param options The options, the maximum frame rate of the canvas.
+     */
+    Window(COMService *com, const Options &options);
+
+    /**
+     * @brief Destroys the Window object and stops the notifications of the COMService.
+     */
+    ~Window();
+
+    /**
+     * @brief Returns the latency of the changes shown so far.
+     * @return The latency of every stage.
+     */
+    const Latency &getLatency() const { return latency; }
+
+protected:
+    /**
+     * @brief The key press event handler, F3 toggles the latency overlay.
+     * @param event The key press event.
      */
-    Window(COMService *com);
+    void keyPressEvent(QKeyEvent *event) override;
 
 private:
+    /**
+     * @brief Refreshes the canvas now, or later if the maximum frame rate would be exceeded.
+     */
+    void schedule();
+
     /**
      * @brief Refreshes the canvas by redrawing its contents.
      */
     void refresh();
+
+    /**
+     * @brief Counts the latency of the pending change once the canvas painted it and updates the overlay.
+     */
+    void painted();
+
+    /**
+     * @brief Returns the lines of the latency overlay, with the health of the link.
+     */
+    QStringList overlayLines(void) const;
 };
 
 #endif // WINDOW_H
@@ -2,30 +2,125 @@
  * @file main.cpp
  * @brief This file contains the main function that initializes the client window and starts the application.
  *
- * The main function initializes the QApplication and creates a Window object. The Window object is then shown and the
- * application is started by calling app.exec().
+ * The main function initializes the QApplication, parses the options and creates the transport chosen in them,
+ * then creates a Window object. The Window object is then shown and the application is started by calling app.exec().
+ * With --record, every frame accepted by the transport is appended to a frame log from the I/O thread.
+ * With --render, the canvas is rendered offscreen instead, on the offscreen platform unless QT_QPA_PLATFORM is set.
+ * With --latency, the latency histograms collected by the window are dumped when the application quits.
+ * With --metrics, the health of the transport is served on a loopback port in the Prometheus text format.
  */
 #include <QApplication>
+#include <QElapsedTimer>
+#include <QDebug>
+#include <cstdio>
 #include "window.h"
-#ifdef UARTCOM
-#include "uartservice.h"
-#else
-#include "tcpservice.h"
-#endif
+#include "canvas.h"
+#include "options.h"
+#include "framelog.h"
+#include "metrics.h"
+
+/**
+ * @brief Renders a fixed number of frames into an image as fast as possible and prints the frame rate.
+ *
+ * Every frame is a whole canvas with new values, the worst case of the window that only repaints what changed.
+ * The values only depend on the index of the frame, so the last frame is the same from run to run and can serve
+ * as a reference image. The lights stay off, so no sound plays.
+ *
+ * @param options The options, the number of frames and the optional snapshot file.
+ * @return int Exit code of the application.
+ */
+static int renderOffscreen(const Options &options)
+{
+    Canvas canvas;
+    canvas.resize(Setting::Client::Windows::Width, Setting::Client::Windows::Height);
+    canvas.setStatus(true);
+
+    QImage image;
+    canvas.renderFrame(image); /**<Build the geometry, the dial layer and the glyphs before timing*/
+
+    QElapsedTimer timer;
+    timer.start();
+    for (int i = 0; i < options.frames; i++)
+    {
+        canvas.setSpeed(i % (Setting::Signal::Speed::MAX + 1));
+        canvas.setBatteryLevel(Setting::Signal::BatteryLevel::MAX - i % (Setting::Signal::BatteryLevel::MAX + 1));
+        canvas.setTemperature(Setting::Signal::Temperature::MIN + i % (Setting::Signal::Temperature::MAX - Setting::Signal::Temperature::MIN + 1));
+        canvas.renderFrame(image);
+    }
+    double nanoseconds = static_cast<double>(timer.nsecsElapsed());
+
+    std::printf("{\"name\":\"canvas.offscreen\",\"iterations\":%d,\"ns_per_op\":%.2f,\"fps\":%.1f,\"width\":%d,\"height\":%d}\n",
+                options.frames, nanoseconds / options.frames, options.frames * 1e9 / nanoseconds, image.width(), image.height());
+
+    if (!options.snapshot.isEmpty() && !image.save(options.snapshot))
+    {
+        qCritical().noquote() << "Cannot save the snapshot:" << options.snapshot;
+        return 1;
+    }
+
+    return 0;
+}
 
 int main(int argc, char *argv[])
 {
+    if ((Options::peek(argc, argv, "render").toInt() > 0) && qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) /**<From the command line or the config file*/
+    {
+        qputenv("QT_QPA_PLATFORM", "offscreen"); /**<No window is shown, so no display is needed*/
+    }
+
     QApplication app(argc, argv); /**<Create a QApplication object*/
 
-#ifdef UARTCOM /**<Check if UART communication is enabled*/
-    UARTService service;
-#else /**<If UART communication is not enabled*/
-    TCPService service;
-#endif
+    Options options; /**<The transport and its parameters*/
+    QString error;   /**<The reason when the options are invalid*/
+
+    if (!options.parse(app, Options::Role::Client, error)) /**<Parse the command line and the config file*/
+    {
+        qCritical().noquote() << error;
+        return 1;
+    }
+
+    if (options.frames > 0)
+    {
+        return renderOffscreen(options); /**<Render without a window nor a transport*/
+    }
+
+    FrameLog::Writer recorder; /**<Declared before the service, so it is closed after the I/O thread stopped*/
+
+    if (!options.record.isEmpty() && !recorder.open(options.record.toLocal8Bit().constData(), options.records))
+    {
+        qCritical().noquote() << "Cannot create the recording:" << options.record;
+        return 1;
+    }
+
+    std::unique_ptr<COMService> service = COMService::create(options); /**<Create the transport chosen in the options*/
 
-    Window clientWindow{&service}; /**<Create a Window object*/
+    if (!options.record.isEmpty())
+    {
+        service->setObserver([&recorder](const Protocol::Header &header, const Codec::Frame &frame)
+                             { recorder.append(header, frame.data(), Protocol::now()); });
+    }
+
+    Metrics::Exporter exporter; /**<Declared after the service, so it stops serving before the service is destroyed*/
+    const std::string labels = std::string{"role=\"client\",transport=\""} + options.transportName() + "\"";
+
+    if ((options.metrics != 0) && !exporter.open(options.metrics, [&service, labels]()
+                                                 { return service->getMetrics().format(labels); }))
+    {
+        qCritical().noquote() << "Cannot serve the metrics on port" << options.metrics;
+        return 1;
+    }
+
+    Window clientWindow{service.get(), options}; /**<Create a Window object*/
 
     clientWindow.show(); /**<Show the Window object*/
 
-    return app.exec(); /**<Start the application*/
+    int code = app.exec(); /**<Start the application*/
+
+    if (!options.latency.isEmpty() && !clientWindow.getLatency().dump(options.latency))
+    {
+        qCritical().noquote() << "Cannot write the latency:" << options.latency;
+        return 1;
+    }
+
+    return code;
 }
@@ -2,6 +2,7 @@
 #include "setting.h"
 #include <QFileInfo>
 #include <QPaintEvent>
+#include <QResizeEvent>
 #include <QFontDatabase>
 #include <QMediaDevices>
 #include <QAudioDevice>
@@ -31,6 +32,193 @@ Canvas::Canvas()
      *
      */
     brush = QBrush(QColor(0xa6, 0x2e, 0x39));
+    speedIconFont.setPixelSize(50);              /**<Adjust the font size of the speedometer icon as needed*/
+    overlayFont.setStyleHint(QFont::TypeWriter); /**<Fall back to any fixed-pitch font, the columns of the overlay must line up*/
+
+    /**
+     * @brief The arrows blink on their own timer, the canvas is otherwise only repainted when a value changed
+     *
+     */
+    connect(&blinkTimer, &QTimer::timeout, this, [this]()
+            {
+        blink = (blink + 1) % MAX_BLINK; /**<Increment the blink counter*/
+        update(leftArrowRect.adjusted(-GLYPH_MARGIN, -GLYPH_MARGIN, GLYPH_MARGIN, GLYPH_MARGIN)); /**<Repaint only the arrows*/
+        update(rightArrowRect.adjusted(-GLYPH_MARGIN, -GLYPH_MARGIN, GLYPH_MARGIN, GLYPH_MARGIN)); });
+}
+
+/**
+ * @brief Sets the battery level and repaints the battery region if it changed.
+ *
+ * @param level The new battery level.
+ */
+void Canvas::setBatteryLevel(uint32_t level)
+{
+    if (level != batteryLevel)
+    {
+        batteryLevel = level;
+        update(batteryRect);
+    }
+}
+
+/**
+ * @brief Sets the temperature and repaints the temperature region if it changed.
+ *
+ * @param temp The new temperature.
+ */
+void Canvas::setTemperature(int32_t temp)
+{
+    if (temp != temperature)
+    {
+        temperature = temp;
+        update(temperatureRect);
+    }
+}
+
+/**
+ * @brief Sets the status and repaints the whole canvas if it changed.
+ *
+ * @param sts The new status.
+ */
+void Canvas::setStatus(bool sts)
+{
+    if (sts != status)
+    {
+        status = sts;
+        update();
+    }
+}
+
+/**
+ * @brief Sets the text shown instead of the speed and repaints the readout if it changed.
+ *
+ * @param text The new text.
+ */
+void Canvas::setStatusText(StatusText text)
+{
+    if (text != statusText)
+    {
+        statusText = text;
+        update(readoutRect());
+    }
+}
+
+/**
+ * @brief Sets the speed and repaints the old and new needle sectors and the readout if it changed.
+ *
+ * @param spd The new speed.
+ */
+void Canvas::setSpeed(uint32_t spd)
+{
+    if (spd != speed)
+    {
+        update(needleRect(speed)); /**<Erase the needle at the old speed*/
+        speed = spd;
+        update(needleRect(speed)); /**<Draw the needle at the new speed*/
+        update(readoutRect());
+    }
+}
+
+/**
+ * @brief Sets the state of the lights and starts or stops the blinking and the turn signal sound.
+ *
+ * @param left The state of the left light.
+ * @param right The state of the right light.
+ */
+void Canvas::setLight(bool left, bool right)
+{
+    if (left != leftLight)
+    {
+        update(leftArrowRect.adjusted(-GLYPH_MARGIN, -GLYPH_MARGIN, GLYPH_MARGIN, GLYPH_MARGIN));
+    }
+    if (right != rightLight)
+    {
+        update(rightArrowRect.adjusted(-GLYPH_MARGIN, -GLYPH_MARGIN, GLYPH_MARGIN, GLYPH_MARGIN));
+    }
+
+    leftLight = left;
+    rightLight = right;
+
+    if (leftLight || rightLight) /**<Check if either the left or right turn signal is on*/
+    {
+        if (!blinkTimer.isActive())
+        {
+            blinkTimer.start(Setting::INTERVAL); /**<Blink with the interval defined in the shared setting.h file*/
+        }
+
+        if (!turnSignalSound.isPlaying()) /**<Check if the turn signal sound is not playing*/
+        {
+            turnSignalSound.play(); /**<Play the turn signal sound*/
+        }
+    }
+    else
+    {
+        blinkTimer.stop();      /**<Stop the blinking*/
+        blink = 0;              /**<Reset the blink counter*/
+        turnSignalSound.stop(); /**<Stop the turn signal sound*/
+    }
+}
+
+/**
+ * @brief Sets whether the battery level is stale and repaints the battery region if it changed.
+ *
+ * @param stale True if no frame arrived for too long.
+ */
+void Canvas::setBatteryStale(bool stale)
+{
+    if (stale != batteryStale)
+    {
+        batteryStale = stale;
+        update(batteryRect);
+    }
+}
+
+/**
+ * @brief Sets whether the temperature is stale and repaints the temperature region if it changed.
+ *
+ * @param stale True if no frame arrived for too long.
+ */
+void Canvas::setTemperatureStale(bool stale)
+{
+    if (stale != temperatureStale)
+    {
+        temperatureStale = stale;
+        update(temperatureRect);
+    }
+}
+
+/**
+ * @brief Sets whether the speed is stale and repaints the needle sector and the readout if it changed.
+ *
+ * @param stale True if no frame arrived for too long.
+ */
+void Canvas::setSpeedStale(bool stale)
+{
+    if (stale != speedStale)
+    {
+        speedStale = stale;
+        update(needleRect(speed));
+        update(readoutRect());
+    }
+}
+
+/**
+ * @brief Sets whether the state of the lights is stale and repaints the arrows that changed.
+ *
+ * @param left True if the state of the left light is stale.
+ * @param right True if the state of the right light is stale.
+ */
+void Canvas::setLightStale(bool left, bool right)
+{
+    if (left != leftLightStale)
+    {
+        leftLightStale = left;
+        update(leftArrowRect.adjusted(-GLYPH_MARGIN, -GLYPH_MARGIN, GLYPH_MARGIN, GLYPH_MARGIN));
+    }
+    if (right != rightLightStale)
+    {
+        rightLightStale = right;
+        update(rightArrowRect.adjusted(-GLYPH_MARGIN, -GLYPH_MARGIN, GLYPH_MARGIN, GLYPH_MARGIN));
+    }
 }
 
 /**
@@ -40,24 +228,228 @@ Canvas::Canvas()
  */
 void Canvas::paintEvent(QPaintEvent *event)
 {
-    painter.begin(this);                                      /**<Start painting*/
-    painter.setRenderHint(QPainter::Antialiasing);            /**<Set the render hint*/
-    painter.fillRect(event->rect(), QBrush(QColor(6, 6, 6))); /**<Fill the rectangle with the specified brush*/
+    paint(this, event->region());
+
+    if (painted)
+    {
+        painted(); /**<The paint is complete once the painter ended, the backing store is flushed right after*/
+    }
+}
+
+/**
+ * @brief Sets the lines of the debug overlay and repaints its region.
+ *
+ * @param lines The lines, or an empty list to hide the overlay.
+ */
+void Canvas::setOverlay(const QStringList &lines)
+{
+    if (lines != overlay)
+    {
+        overlay = lines;
+        update(overlayRect);
+    }
+}
+
+/**
+ * @brief Sets the callback invoked on the GUI thread when a paint of the widget completed.
+ *
+ * Rendering into an image does not call it, only the paints of the widget reach the screen.
+ *
+ * @param callback The callback, or nullptr to stop the calls.
+ */
+void Canvas::setPainted(std::function<void(void)> callback)
+{
+    painted = std::move(callback);
+}
+
+/**
+ * @brief Renders the whole canvas into an image, without a window.
+ *
+ * The image is reallocated when the size of the canvas changed, so rendering frame after frame into the same image
+ * allocates nothing. The blink timer is not needed, the arrows are drawn in the current phase of the blink counter.
+ *
+ * @param image The image, in the premultiplied ARGB32 format the raster engine draws fastest.
+ */
+void Canvas::renderFrame(QImage &image)
+{
+    const QSize pixels = size() * devicePixelRatioF(); /**<The size of the canvas in device pixels*/
+
+    if ((image.size() != pixels) || (image.format() != QImage::Format_ARGB32_Premultiplied))
+    {
+        image = QImage(pixels, QImage::Format_ARGB32_Premultiplied);
+    }
+    image.setDevicePixelRatio(devicePixelRatioF());
+
+    if (geometrySize != size()) /**<A hidden widget gets no resize event, so the dial layer is checked here*/
+    {
+        dialLayer = QPixmap();
+    }
+
+    paint(&image, QRegion(rect()));
+}
+
+/**
+ * @brief Paints the canvas on a device, the widget itself or an image.
+ *
+ * Only the elements whose region intersects the dirty region are drawn, the painter of a widget is clipped to it.
+ *
+ * @param device The device to paint on.
+ * @param dirty The region to repaint.
+ */
+void Canvas::paint(QPaintDevice *device, const QRegion &dirty)
+{
+    painter.begin(device);                                           /**<Start painting*/
+    painter.setRenderHint(QPainter::Antialiasing);                   /**<Set the render hint*/
+    painter.fillRect(dirty.boundingRect(), QBrush(QColor(6, 6, 6))); /**<Fill the rectangle with the specified brush*/
 
     /**
      * @brief Call the diffrent Drawing functions.
      *
      * @return * Call
      */
-    drawBatteryLevel();      /**<Call the drawBatteryLevel function*/
-    drawTmpLevel();          /**<Call the drawTmpLevel function*/
-    drawArrows();            /**<Call the drawArrows function*/
-    drawSpeed();             /**<Call the drawSpeed function*/
-    drawSpeedometerNeedle(); /**<Call the drawSpeedometerNeedle function*/
+    if (dirty.intersects(batteryRect))
+    {
+        drawBatteryLevel(); /**<Call the drawBatteryLevel function*/
+    }
+    if (dirty.intersects(temperatureRect))
+    {
+        drawTmpLevel(); /**<Call the drawTmpLevel function*/
+    }
+    if (dirty.intersects(leftArrowRect.adjusted(-GLYPH_MARGIN, -GLYPH_MARGIN, GLYPH_MARGIN, GLYPH_MARGIN)) ||
+        dirty.intersects(rightArrowRect.adjusted(-GLYPH_MARGIN, -GLYPH_MARGIN, GLYPH_MARGIN, GLYPH_MARGIN)))
+    {
+        drawArrows(); /**<Call the drawArrows function*/
+    }
+    if (intersectsDial(dirty) || dirty.intersects(readoutRect())) /**<The arrows lie in the corners of dialRect, outside the dial*/
+    {
+        drawSpeed();             /**<Call the drawSpeed function*/
+        drawSpeedometerNeedle(); /**<Call the drawSpeedometerNeedle function*/
+    }
+    if (!overlay.isEmpty() && dirty.intersects(overlayRect))
+    {
+        drawOverlay(); /**<Drawn last, over the dial*/
+    }
 
     painter.end(); /**<End painting*/
 }
 
+/**
+ * @brief This function is called whenever the canvas is resized.
+ *
+ * The dial layer depends on the size of the canvas, it is rendered again on the next paint.
+ *
+ * @param event The resize event.
+ */
+void Canvas::resizeEvent(QResizeEvent *event)
+{
+    dialLayer = QPixmap(); /**<Invalidate the dial layer*/
+    QWidget::resizeEvent(event);
+}
+
+/**
+ * @brief Returns the rotation of the needle for a speed value.
+ *
+ * -2.48 is the offset for the needle.
+ *
+ * @param value The speed the needle points to.
+ * @return qreal The rotation of the needle in degrees.
+ */
+qreal Canvas::needleAngle(uint32_t value) const
+{
+    int startA = -37 * 16; /**<Start angle for the markings*/
+    int endA = 217 * 16;   /**<End angle for the markings*/
+
+    qreal needleValue = -static_cast<qreal>(value);                                    /**<The value at which the needle should point*/
+    qreal zeroAngle = startA;                                                          /**<The angle at which the needle should point to the value 0*/
+    return (zeroAngle + (endA - zeroAngle) * (-2.48 - (needleValue / 240.0))) / 16.0; /**<Calculate the angle at which the needle should point*/
+}
+
+/**
+ * @brief Returns the region covered by the needle and the center circle.
+ *
+ * @param value The speed the needle points to.
+ * @return QRect The bounding rectangle, padded for the antialiasing and the circle outline.
+ */
+QRect Canvas::needleRect(uint32_t value)
+{
+    int centerX = width() / 2 * 0.9;  /**<Calculate the center X-coordinate of the canvas*/
+    int centerY = height() / 2 * 1.2; /**<Calculate the center Y-coordinate of the canvas*/
+    int circleRadius = 15 + 4;        /**<The radius of the center circle and its outline*/
+
+    QRect circle{centerX - circleRadius, centerY - circleRadius, circleRadius * 2, circleRadius * 2};
+    return needle(value).boundingRect().toAlignedRect().adjusted(-2, -2, 2, 2).united(circle);
+}
+
+/**
+ * @brief Returns the needle polygon for a speed value from the precomputed table.
+ *
+ * @param value The speed the needle points to, clamped to the range of the speed signal.
+ * @return const QPolygonF& The needle in canvas coordinates.
+ */
+const QPolygonF &Canvas::needle(uint32_t value)
+{
+    if (geometrySize != size()) /**<Check if the geometry must be computed again*/
+    {
+        buildGeometry();
+    }
+
+    uint32_t index = qMin(value, static_cast<uint32_t>(Setting::Signal::Speed::MAX)) - Setting::Signal::Speed::MIN;
+    return needles[index];
+}
+
+/**
+ * @brief Returns the region of the speedometer dial.
+ *
+ * @return QRect The bounding rectangle of the arc including its outline.
+ */
+QRect Canvas::dialRect(void) const
+{
+    int centerX = width() / 2 * 0.9;  /**<Calculate the center X-coordinate of the canvas*/
+    int centerY = height() / 2 * 1.2; /**<Calculate the center Y-coordinate of the canvas*/
+    int radius = qMin(width(), height()) * 0.55 + 8;
+
+    return QRect(centerX - radius, centerY - radius, radius * 2, radius * 2);
+}
+
+/**
+ * @brief Tells whether a region overlaps the circle of the dial.
+ *
+ * The arc, the markings, the labels and the needle all lie within the circle of dialRect, so a rectangle of the region
+ * whose closest point to the center is farther than the radius, e.g. a blinking arrow in a corner, needs no dial.
+ *
+ * @param region The region, e.g. the dirty region of a paint.
+ * @return true The region overlaps the circle.
+ * @return false The region only overlaps the corners of dialRect, or not at all.
+ */
+bool Canvas::intersectsDial(const QRegion &region) const
+{
+    const QRect dial = dialRect();
+    const int centerX = dial.left() + dial.width() / 2; /**<The center of the canvas, as computed by dialRect*/
+    const int centerY = dial.top() + dial.height() / 2;
+    const qint64 radius = dial.width() / 2;
+
+    for (const QRect &rect : region)
+    {
+        const qint64 dx = qBound(rect.left(), centerX, rect.right()) - centerX; /**<The closest point of the rectangle to the center*/
+        const qint64 dy = qBound(rect.top(), centerY, rect.bottom()) - centerY;
+        if ((dx * dx) + (dy * dy) <= radius * radius)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Returns the region of the speed icon and the speed value text.
+ *
+ * @return QRect The bounding rectangle of the readout, the text position is defined in drawSpeed.
+ */
+QRect Canvas::readoutRect(void) const
+{
+    return QRect(width() / 2 - 110, height() - 130, 220, 130);
+}
+
 /**
  * @brief Draws the battery level on the canvas.
  *
@@ -94,12 +486,13 @@ void Canvas::drawBatteryLevel()
     {
         symbolColor = QColor(0, 255, 0); /**<Green for battery level > 49%.*/
     }
+    if (batteryStale)
+    {
+        symbolColor = staleColor; /**<Grey if no frame arrived for too long.*/
+    }
 
     /**<Draw battery icon with the selected color.*/
-    iconFont = QFont("Material Icons", 50, QFont::Normal);                       /**<Font*/
-    painter.setPen(symbolColor);                                                 /**<Use the selected color*/
-    painter.setFont(iconFont);                                                   /**<Font*/
-    painter.drawText(QRect(680, 280, 100, 100), Qt::AlignCenter, QChar(0xebdc)); /**<Battery icon.*/
+    glyphs.drawIcon(painter, QRect(680, 280, 100, 100), Element::Icon, QChar(0xebdc), iconFont, symbolColor); /**<Battery icon.*/
 
     // Draw battery level rectangle
     painter.setPen(Qt::NoPen);                                                    /**<No outline*/
@@ -107,10 +500,8 @@ void Canvas::drawBatteryLevel()
     painter.drawRect(QRect(716, 153 + (200 - batteryHeight), 28, batteryHeight)); /**<Rectangle dimensions*/
 
     // Draw Battery level
-    painter.setPen(QColor(255, 255, 255));                                     /**<White text*/
-    painter.setFont(QFont("Arial", 11));                                       /**<Font*/
-    QString batteryText = QString::number(batteryLevel) + " %";                /**<Battery level text*/
-    painter.drawText(QRect(680, 330, 100, 100), Qt::AlignCenter, batteryText); /**<Draw the text*/
+    auto batteryText = [this] { return QString::number(batteryLevel) + " %"; };                                                                                                /**<Battery level text, only built if not cached*/
+    glyphs.draw(painter, QRect(680, 330, 100, 100), GlyphCache::id(Element::Battery, batteryLevel), batteryText, textFont, batteryStale ? staleColor : QColor(255, 255, 255)); /**<Draw the text in white, grey if stale*/
 }
 
 /**
@@ -124,10 +515,8 @@ void Canvas::drawBatteryLevel()
  */
 void Canvas::drawTmpLevel(void)
 {
-    painter.setPen(QColor(255, 255, 255));                                         /**<White Text*/
-    painter.setFont(QFont("Arial", 11));                                           /**<Font and Font size*/
-    QString temperatureText = QString::number(temperature) + " °C";                /**<Temperature text*/
-    painter.drawText(QRect(680, 425, 100, 100), Qt::AlignCenter, temperatureText); /**<Draw the text*/
+    auto temperatureText = [this] { return QString::number(temperature) + " °C"; };                                                                                                                             /**<Temperature text, only built if not cached*/
+    glyphs.draw(painter, QRect(680, 425, 100, 100), GlyphCache::id(Element::Temperature, static_cast<quint32>(temperature)), temperatureText, textFont, temperatureStale ? staleColor : QColor(255, 255, 255)); /**<Draw the text in white, grey if stale*/
 
     /**
      * @brief Choose the temperature icon color based on the temperature level.
@@ -146,21 +535,22 @@ void Canvas::drawTmpLevel(void)
     {
         iconColor = QColor(255, 0, 0); /**<Red for temperatures above 39°C.*/
     }
+    if (temperatureStale)
+    {
+        iconColor = staleColor; /**<Grey if no frame arrived for too long.*/
+    }
 
     /**
      * @brief Draw the temperature icon with the selected color.
      *
      */
-    iconFont = QFont{"Material Icons", 50, QFont::Normal};                       /**<Font*/
-    painter.setPen(QColor(iconColor));                                           /**<Use the selected color*/
-    painter.setFont(iconFont);                                                   /**<Font*/
-    painter.drawText(QRect(680, 380, 100, 100), Qt::AlignCenter, QChar(0xf076)); /**<Temperature icon.*/
+    glyphs.drawIcon(painter, QRect(680, 380, 100, 100), Element::Icon, QChar(0xf076), iconFont, iconColor); /**<Temperature icon.*/
 }
 
 /**
  * @brief Draws arrows on the canvas based on the state of the left and right turn signals.
  *
- * @details The function draws arrows on the canvas using the QPainter object. The arrows are Material Icons and are drawn in green color. The left arrow is drawn on the left side of the canvas and the right arrow is drawn on the right side of the canvas. The arrows blink on and off based on the state of the turn signals. If either the left or right turn signal is on, the arrows will blink and a turn signal sound will play. If both turn signals are off, the arrows will not blink and the turn signal sound will stop.
+ * @details The function draws arrows on the canvas using the QPainter object. The arrows are Material Icons and are drawn in green color. The left arrow is drawn on the left side of the canvas and the right arrow is drawn on the right side of the canvas. The arrows blink on and off based on the blink counter, which is advanced by the blink timer while a turn signal is on.
  *
  * @param void
  * @return void
@@ -170,51 +560,37 @@ void Canvas::drawTmpLevel(void)
  */
 void Canvas::drawArrows(void)
 {
-    constexpr int MAX_COUNT{14}; /**<Adjust the maximum count as needed. Higher values will result in slower blinking.*/
-    static int blink{0};         /**<Initialize the blink counter.*/
-    if (leftLight || rightLight) /**<Check if either the left or right turn signal is on*/
-    {
-        blink = (blink + 1) % MAX_COUNT; /**<Increment the blink counter*/
-
-        if (!turnSignalSound.isPlaying()) /**<Check if the turn signal sound is not playing*/
-        {
-            turnSignalSound.play(); /**<Play the turn signal sound*/
-        }
-    }
-    else
-    {
-        blink = 0;              /**<Reset the blink counter*/
-        turnSignalSound.stop(); /**<Stop the turn signal sound*/
-    }
-    if (blink <= MAX_COUNT / 2) /**<Check if the blink counter is less than or equal to half of the maximum count*/
+    if (blink <= MAX_BLINK / 2) /**<Check if the blink counter is less than or equal to half of the maximum count*/
     {
-        painter.setFont(QFont{"Material Icons", 46, QFont::Normal}); /**<Set the font and font size*/
         if (leftLight)
         {
-            painter.setPen(QColor(0, 255, 0));                                      /**<Set the pen color to green*/
-            painter.drawText(QRect(10, 5, 40, 40), Qt::AlignCenter, QChar(0xe5c4)); /**<Left Arrow Icon*/
+            glyphs.drawIcon(painter, leftArrowRect, Element::Arrow, QChar(0xe5c4), arrowFont, leftLightStale ? staleColor : QColor(0, 255, 0)); /**<Left Arrow Icon in green, grey if stale*/
         }
         if (rightLight)
         {
-            painter.setPen(QColor(0, 255, 0));                                       /**<Set the pen color to green*/
-            painter.drawText(QRect(620, 5, 40, 40), Qt::AlignCenter, QChar(0xe5c8)); /**<Right Arrow Icon*/
+            glyphs.drawIcon(painter, rightArrowRect, Element::Arrow, QChar(0xe5c8), arrowFont, rightLightStale ? staleColor : QColor(0, 255, 0)); /**<Right Arrow Icon in green, grey if stale*/
         }
     }
 }
 
 /**
- * @brief Draws a speedometer on the canvas.
+ * @brief Computes the geometry of the dial and the needle for the current size of the canvas.
  *
- * This function draws a speedometer on the canvas using the provided parameters.
+ * This function computes every marking and label of the dial, and the needle polygon for every speed value,
+ * so that painting does no trigonometry at all.
  * It calculates the center X and Y coordinates of the canvas, as well as the radius of the circle to fit within the canvas.
- * It then sets up the pen for drawing the arc outline and draws the arc outline.
- * Main markings are drawn at evenly spaced intervals, with the number of sub-markings and their thickness and radius being adjustable.
- * Sub-markings and sub-sub-markings are also drawn between main markings.
+ * Main markings are placed at evenly spaced intervals, with the number of sub-markings and their thickness and radius being adjustable.
+ * Sub-markings and sub-sub-markings are also placed between main markings.
  *
  * @return void
  */
-void Canvas::drawSpeed(void)
+void Canvas::buildGeometry(void)
 {
+    markings.clear();
+    labels.clear();
+    needles.clear();
+    geometrySize = size();
+
     int centerX = width() / 2 * 0.9;  /**<Calculate the center X-coordinate of the canvas*/
     int centerY = height() / 2 * 1.2; /**<Calculate the center Y-coordinate of the canvas*/
 
@@ -227,23 +603,13 @@ void Canvas::drawSpeed(void)
     int startA = -37 * 16; /**<Start angle for the markings*/
     int endA = 217 * 16;   /**<End angle for the markings*/
 
-    /**<Set up the pen for drawing the arc outline*/
-    QPen pen(Qt::white);        /**<Color of the arc outline */
-    int arcThickness = 8;       /**<Thickness of the arc outline in pixels*/
-    pen.setWidth(arcThickness); /**<Adjust the pen width as needed*/
-    painter.setPen(pen);
-
-    /**<Draw the arc outline*/
-    painter.drawArc(centerX - radius, centerY - radius, radius * 2, radius * 2, startAngle, endAngle - startAngle);
-
-    /**<Draw main markings at evenly spaced intervals*/
+    /**<Compute main markings at evenly spaced intervals*/
     int numMainMarkings = 13;
     int numSubMarkings = 1;          /**<Adjust the number of sub-markings*/
     int markingThickness = 7;        /**<Adjust the thickness of the markings*/
     int markingRadius = radius - 25; /**<Adjust the radius where markings are drawn*/
     int markingLength = 25;
 
-    pen.setWidth(markingThickness); /**<Thickness of the markings outline in pixels*/
     qreal angleIncrement = static_cast<qreal>(endA - startA) / (numMainMarkings - 1);
 
     for (int i = 0; i < numMainMarkings; ++i)
@@ -256,10 +622,9 @@ void Canvas::drawSpeed(void)
         qreal endX = centerX + (radius - markingLength) * qCos(angleRadians); /**<Calculate the end X-coordinate of the marking*/
         qreal endY = centerY - (radius - markingLength) * qSin(angleRadians); /**<Calculate the end Y-coordinate of the marking*/
 
-        painter.setPen(QPen(Qt::white, markingThickness));              /**<Set the pen for drawing the markings*/
-        painter.drawLine(QPointF(startX, startY), QPointF(endX, endY)); /**<Draw the marking*/
+        markings.append({QLineF(QPointF(startX, startY), QPointF(endX, endY)), markingThickness}); /**<Store the marking*/
 
-        // Draw sub-markings
+        // Compute sub-markings
         if (i != numMainMarkings - 1)
         {
             qreal subMarkingAngleIncrement = (endAngle - startAngle) / (numMainMarkings - 1) / (numSubMarkings + 1); /**<Angle increment between sub-markings*/
@@ -272,12 +637,11 @@ void Canvas::drawSpeed(void)
                 qreal subMarkingEndX = subMarkingStartX + markingLength * 0.5 * qCos(qDegreesToRadians(subMarkingAngle / 16.0)); /**<Calculate the end X-coordinate of the sub-marking*/
                 qreal subMarkingEndY = subMarkingStartY - markingLength * 0.5 * qSin(qDegreesToRadians(subMarkingAngle / 16.0)); /**<Calculate the end Y-coordinate of the sub-marking*/
 
-                painter.setPen(QPen(Qt::white, 3));                                                                     /**<Set the pen for drawing the sub-markings*/
-                painter.drawLine(QPointF(subMarkingStartX, subMarkingStartY), QPointF(subMarkingEndX, subMarkingEndY)); /**<Draw the sub-marking*/
+                markings.append({QLineF(QPointF(subMarkingStartX, subMarkingStartY), QPointF(subMarkingEndX, subMarkingEndY)), 3}); /**<Store the marking*/
 
                 subMarkingAngle += subMarkingAngleIncrement; /**<Calculate the angle for the next sub-marking*/
 
-                /**<Draw sub-sub-markings between main and sub markings*/
+                /**<Compute sub-sub-markings between main and sub markings*/
                 qreal subSubMarkingAngleIncrement = subMarkingAngleIncrement / (numSubMarkings + 1); /**<Angle increment between sub-sub-markings*/
                 qreal subSubMarkingAngle = subMarkingAngle - subSubMarkingAngleIncrement;            /**<Angle for the first sub-sub-marking*/
                 qreal subSubMarkingAngle2 = angle + subSubMarkingAngleIncrement;                     /**<Angle for the second sub-sub-marking*/
@@ -289,8 +653,7 @@ void Canvas::drawSpeed(void)
                     qreal subSubMarkingEndX = subSubMarkingStartX + markingLength * 0.25 * qCos(qDegreesToRadians(subSubMarkingAngle / 16.0)); /**<Calculate the end X-coordinate of the sub-sub-marking*/
                     qreal subSubMarkingEndY = subSubMarkingStartY - markingLength * 0.25 * qSin(qDegreesToRadians(subSubMarkingAngle / 16.0)); /**<Calculate the end Y-coordinate of the sub-sub-marking*/
 
-                    painter.setPen(QPen(Qt::white, 2));                                                                                 /**<Set the pen for drawing the sub-sub-markings*/
-                    painter.drawLine(QPointF(subSubMarkingStartX, subSubMarkingStartY), QPointF(subSubMarkingEndX, subSubMarkingEndY)); /**<Draw the sub-sub-marking*/
+                    markings.append({QLineF(QPointF(subSubMarkingStartX, subSubMarkingStartY), QPointF(subSubMarkingEndX, subSubMarkingEndY)), 2}); /**<Store the marking*/
 
                     subSubMarkingAngle -= subSubMarkingAngleIncrement; /**<Calculate the angle for the next sub-sub-marking*/
 
@@ -299,8 +662,7 @@ void Canvas::drawSpeed(void)
                     qreal subSubMarkingEndX2 = subSubMarkingStartX2 + markingLength * 0.25 * qCos(qDegreesToRadians(subSubMarkingAngle2 / 16.0)); /**<Calculate the end X-coordinate of the sub-sub-marking*/
                     qreal subSubMarkingEndY2 = subSubMarkingStartY2 - markingLength * 0.25 * qSin(qDegreesToRadians(subSubMarkingAngle2 / 16.0)); /**<Calculate the end Y-coordinate of the sub-sub-marking*/
 
-                    painter.setPen(QPen(Qt::white, 2));                                                                                     /**<Set the pen for drawing the sub-sub-markings*/
-                    painter.drawLine(QPointF(subSubMarkingStartX2, subSubMarkingStartY2), QPointF(subSubMarkingEndX2, subSubMarkingEndY2)); /**<Draw the sub-sub-marking*/
+                    markings.append({QLineF(QPointF(subSubMarkingStartX2, subSubMarkingStartY2), QPointF(subSubMarkingEndX2, subSubMarkingEndY2)), 2}); /**<Store the marking*/
 
                     subSubMarkingAngle2 += subSubMarkingAngleIncrement; /**<Calculate the angle for the next sub-sub-marking*/
 
@@ -313,7 +675,7 @@ void Canvas::drawSpeed(void)
         }
     }
 
-    /**<Draw the integer labels for the speedometer*/
+    /**<Compute the integer labels for the speedometer*/
     int labelRadius = radius - 60; /**<Adjust the radius where labels are drawn*/
     int labelPadding = 10;         /**<Adjust the padding between the labels and the markings*/
 
@@ -332,10 +694,95 @@ void Canvas::drawSpeed(void)
         qreal labelX = centerX + (labelRadius + labelPadding) * qCos(angleRadians) - labelWidth / 2.0;  /**<Calculate the X-coordinate of the label*/
         qreal labelY = centerY - (labelRadius + labelPadding) * qSin(angleRadians) + labelHeight / 4.0; /**<Calculate the Y-coordinate of the label*/
 
-        painter.setFont(labelFont);              /**<Set the font for drawing the label*/
-        painter.setPen(QPen(Qt::white));         /**<Set the pen for drawing the label*/
-        painter.drawText(labelX, labelY, label); /**<Draw the label*/
+        labels.append({QPointF(labelX, labelY), label}); /**<Store the label*/
+    }
+
+    /**<Compute the needle for every speed value*/
+    qreal needleLength = radius - 45; /**<Adjust the length of the needle as needed*/
+    qreal needleWidth = 12;           /**<Adjust the width of the needle as needed*/
+
+    QPolygonF needle{QPointF(0, needleLength), QPointF(-needleWidth / 2, 0), QPointF(needleWidth / 2, 0)}; /**<Top, bottom left and bottom right vertices*/
+
+    for (int value = Setting::Signal::Speed::MIN; value <= Setting::Signal::Speed::MAX; ++value)
+    {
+        QTransform transform;                  /**<Transform from the needle to the canvas*/
+        transform.translate(centerX, centerY); /**<Translate to the center of the canvas*/
+        transform.rotate(needleAngle(value));  /**<Rotate to the needle angle*/
+        needles.append(transform.map(needle)); /**<Store the needle*/
+    }
+}
+
+/**
+ * @brief Renders the static part of the speedometer into the dial layer.
+ *
+ * This function draws the arc, and the markings and labels computed by buildGeometry, into a pixmap the size of the canvas.
+ * The layer only has to be rendered again when the canvas is resized or moved to a screen with another pixel ratio.
+ *
+ * @return void
+ */
+void Canvas::renderDial(void)
+{
+    if (geometrySize != size()) /**<Check if the geometry must be computed again*/
+    {
+        buildGeometry();
+    }
+
+    dialLayer = QPixmap(size() * devicePixelRatioF()); /**<Allocate the layer in device pixels*/
+    dialLayer.setDevicePixelRatio(devicePixelRatioF());
+    dialLayer.fill(Qt::transparent);
+
+    QPainter layer(&dialLayer);                  /**<The painter drawing into the layer*/
+    layer.setRenderHint(QPainter::Antialiasing); /**<Set the render hint*/
+
+    int centerX = width() / 2 * 0.9;  /**<Calculate the center X-coordinate of the canvas*/
+    int centerY = height() / 2 * 1.2; /**<Calculate the center Y-coordinate of the canvas*/
+
+    /**<Calculate the radius of the circle to fit within the canvas*/
+    int radius = qMin(width(), height()) * 0.55; /**<Adjust the scale factor for the needle as needed*/
+
+    int startAngle = -40 * 16; /**<Start angle in degrees * 16 (Qt uses 16-bit fixed point angles)*/
+    int endAngle = 220 * 16;   /**<End angle in degrees * 16*/
+
+    /**<Set up the pen for drawing the arc outline*/
+    QPen pen(Qt::white);        /**<Color of the arc outline */
+    int arcThickness = 8;       /**<Thickness of the arc outline in pixels*/
+    pen.setWidth(arcThickness); /**<Adjust the pen width as needed*/
+    layer.setPen(pen);
+
+    /**<Draw the arc outline*/
+    layer.drawArc(centerX - radius, centerY - radius, radius * 2, radius * 2, startAngle, endAngle - startAngle);
+
+    /**<Draw the markings*/
+    for (const Marking &marking : markings)
+    {
+        layer.setPen(QPen(Qt::white, marking.width)); /**<Set the pen for drawing the marking*/
+        layer.drawLine(marking.line);                 /**<Draw the marking*/
+    }
+
+    /**<Draw the integer labels for the speedometer*/
+    layer.setFont(QFont("Arial", 14, QFont::Bold)); /**<Set the font for drawing the labels*/
+    layer.setPen(QPen(Qt::white));                  /**<Set the pen for drawing the labels*/
+    for (const Label &label : labels)
+    {
+        layer.drawText(label.position, label.text); /**<Draw the label*/
     }
+}
+
+/**
+ * @brief Draws a speedometer on the canvas.
+ *
+ * This function blits the cached dial layer, rendering it first if it is missing or outdated,
+ * and then draws the speed icon and the speed value text.
+ *
+ * @return void
+ */
+void Canvas::drawSpeed(void)
+{
+    if (dialLayer.isNull() || dialLayer.devicePixelRatio() != devicePixelRatioF()) /**<Check if the layer must be rendered again*/
+    {
+        renderDial();
+    }
+    painter.drawPixmap(0, 0, dialLayer); /**<Draw the arc, markings and labels*/
 
     /**<Calculate position for the speed text*/
     int textX = width() / 2 - 80; /**<Adjust the Text X position as needed*/
@@ -345,45 +792,33 @@ void Canvas::drawSpeed(void)
     int logoX = textX;       /**<Adjust the X position for the logo*/
     int logoY = textY - 100; /**<Adjust the Y position for the logo*/
 
-    /**<Draw the speedometer speed logo*/
-    iconFont.setPixelSize(50); /**<Adjust the font size as needed*/
-    painter.setFont(iconFont); /**<Set the font for drawing the logo*/
-
     int iconWidth = 70;  /**<Adjust the width of the icon as needed*/
     int iconHeight = 70; /**<Adjust the height of the icon as needed*/
 
-    QString speedValueText; /**<Initialize the speed value text*/
     if (status)
     {
-        int speedValueX = logoX - 5;                                                                  /**<Adjust X position*/
-        int speedValueY = logoY + iconHeight + 10;                                                    /**<Adjust Y position*/
-        painter.drawText(QRect(logoX, logoY, iconWidth, iconHeight), Qt::AlignCenter, QChar(0xe9e4)); /**<Speedometer icon*/
-        speedValueText = QString::number(speed) + " km/h";                                            /**<Speed value text*/
-        painter.setPen(Qt::white);                                                                    /**<Set the pen for drawing the speed value text*/
-        QFont boldLabelFont("Arial", 20, QFont::Normal);                                              /**<Create a bold version of the label font*/
-        painter.setFont(boldLabelFont);                                                               /**<Set the font for drawing the speed value text*/
-        painter.drawText(speedValueX - 10, speedValueY + 10, speedValueText);                         /**<Draw the speed value text*/
+        QColor readoutColor = speedStale ? staleColor : QColor(Qt::white);                                                                          /**<White unless the speed is stale*/
+        int speedValueX = logoX - 5;                                                                                                                /**<Adjust X position*/
+        int speedValueY = logoY + iconHeight + 10;                                                                                                  /**<Adjust Y position*/
+        glyphs.drawIcon(painter, QRect(logoX, logoY, iconWidth, iconHeight), Element::SpeedIcon, QChar(0xe9e4), speedIconFont, readoutColor);       /**<Speedometer icon*/
+        auto speedValueText = [this] { return QString::number(speed) + " km/h"; };                                                                  /**<Speed value text, only built if not cached*/
+        glyphs.draw(painter, speedValueX - 10, speedValueY + 10, GlyphCache::id(Element::Speed, speed), speedValueText, readoutFont, readoutColor); /**<Draw the speed value text*/
     }
     else
     {
-        int speedValueX = logoX - 5;                                                                  /**<Adjust X position*/
-        int speedValueY = logoY + iconHeight + 10;                                                    /**<Adjust Y position*/
-        QPen redPen(Qt::red);                                                                         /**<Set the pen color to red for the drawing of the speed value text*/
-        painter.setPen(redPen);                                                                       /**<Set the pen for drawing the speed value text*/
-        painter.drawText(QRect(logoX, logoY, iconWidth, iconHeight), Qt::AlignCenter, QChar(0xe628)); /**<Speedometer icon*/
-        speedValueText = "No Signal";                                                                 /**<Speed value text if No Connection to the Server*/
-        QFont boldLabelFont("Arial", 20, QFont::Normal);                                              /**<Create a bold version of the label font*/
-        painter.setFont(boldLabelFont);                                                               /**<Set the font for drawing the speed value text*/
-        painter.drawText(speedValueX - 17, speedValueY + 10, speedValueText);                         /**<Draw the speed value text*/
+        int speedValueX = logoX - 5;                                                                                                                                       /**<Adjust X position*/
+        int speedValueY = logoY + iconHeight + 10;                                                                                                                         /**<Adjust Y position*/
+        glyphs.drawIcon(painter, QRect(logoX, logoY, iconWidth, iconHeight), Element::SpeedIcon, QChar(0xe628), speedIconFont, Qt::red);                                   /**<Speedometer icon in red*/
+        auto speedValueText = [this] { return QString((statusText == StatusText::Connecting) ? "Connecting" : "No Signal"); };                                             /**<Speed value text if No Connection to the Server*/
+        glyphs.draw(painter, speedValueX - 17, speedValueY + 10, GlyphCache::id(Element::Status, static_cast<quint32>(statusText)), speedValueText, readoutFont, Qt::red); /**<Draw the speed value text in red*/
     }
 }
 
 /**
  * @brief Draws a speedometer needle on the canvas.
  *
- * This function draws a speedometer needle on the canvas using QPainter. It calculates the center coordinates of the canvas,
- * the radius of the circle to fit within the canvas, and the angle at which the needle should point. It then draws the center
- * circle and the needle on the canvas.
+ * This function draws a speedometer needle on the canvas using QPainter. It calculates the center coordinates of the canvas
+ * and draws the center circle, then draws the needle polygon precomputed for the current speed by buildGeometry.
  *
  * @param void
  * @return void
@@ -399,12 +834,6 @@ void Canvas::drawSpeedometerNeedle(void)
     int centerX = width() / 2 * 0.9;  /**<Calculate the center X-coordinate of the canvas*/
     int centerY = height() / 2 * 1.2; /**<Calculate the center Y-coordinate of the canvas*/
 
-    /**<Calculate the radius of the circle to fit within the canvas*/
-    int radius = qMin(width(), height()) * 0.55; /**<Adjust the scale factor for the needle as needed*/
-
-    int startA = -37 * 16; /**<Start angle for the markings*/
-    int endA = 217 * 16;   /**<End angle for the markings*/
-
     int circleRadius = 15; /**<Adjust the radius of the center circle as needed*/
 
     /**<Draw the center circle*/
@@ -413,26 +842,32 @@ void Canvas::drawSpeedometerNeedle(void)
     circlePen.setWidth(4);                                                                                   /**<Width of the center circle outline*/
     circlePen.setStyle(Qt::SolidLine);                                                                       /**<Style of the center circle outline*/
     painter.setPen(circlePen);                                                                               /**<Set the pen for drawing the center circle*/
-    painter.setBrush(QBrush(Qt::red));                                                                       /**<Set the brush for drawing the center circle*/
+    painter.setBrush(QBrush(speedStale ? staleColor : QColor(Qt::red)));                                     /**<Set the brush for drawing the center circle*/
     painter.drawEllipse(centerX - circleRadius, centerY - circleRadius, circleRadius * 2, circleRadius * 2); /**<Draw the center circle*/
 
-    /**<Define the coordinates for the needle vertices*/
-    qreal needleLength = radius - 45;               /**<Adjust the length of the needle as needed*/
-    qreal needleWidth = 12;                         /**<Adjust the width of the needle as needed*/
-    QVector<QPointF> needleVertices;                /**<Vector of needle vertices*/
-    needleVertices << QPointF(0, needleLength);     /**<Top vertex of the needle*/
-    needleVertices << QPointF(-needleWidth / 2, 0); /**<Bottom left vertex of the needle*/
-    needleVertices << QPointF(needleWidth / 2, 0);  /**<Bottom right vertex of the needle*/
-
-    /**<Calculate the needle angle -2.48 is the offset for the needle*/
-    qreal needleValue = -static_cast<qreal>(speed);                                       /**<The value at which the needle should point (0 in this case)*/
-    qreal zeroAngle = startA;                                                             /**<The angle at which the needle should point to the value 0*/
-    qreal needleAngle = zeroAngle + (endA - zeroAngle) * (-2.48 - (needleValue / 240.0)); /**<Calculate the angle at which the needle should point*/
-
-    painter.translate(centerX, centerY); /**<Translate the painter to the center of the canvas*/
-    painter.rotate(needleAngle / 16.0);  /**<Rotate the painter to the needle angle*/
-
-    painter.setPen(Qt::NoPen);                 /**<No outline*/
-    painter.setBrush(QBrush(Qt::red));         /**<Red needle*/
-    painter.drawConvexPolygon(needleVertices); /**<Draw the needle*/
+    painter.setPen(Qt::NoPen);                                           /**<No outline*/
+    painter.setBrush(QBrush(speedStale ? staleColor : QColor(Qt::red))); /**<Red needle, grey if the speed is stale*/
+    painter.drawConvexPolygon(needle(speed));                            /**<Draw the needle from the precomputed table*/
+}
+
+/**
+ * @brief Draws the debug overlay, one line of fixed-pitch text per row on a translucent background.
+ *
+ * The text changes with every refresh of the overlay, so it is drawn directly instead of through the glyph cache.
+ */
+void Canvas::drawOverlay(void)
+{
+    painter.setPen(Qt::NoPen);                  /**<No outline*/
+    painter.setBrush(QColor(0, 0, 0, 180));     /**<Translucent black*/
+    painter.drawRoundedRect(overlayRect, 4, 4); /**<Background of the overlay*/
+    painter.setFont(overlayFont);               /**<Fixed-pitch font*/
+    painter.setPen(QColor(0xc0, 0xc0, 0xc0));   /**<Light grey text*/
+
+    const int lineHeight = painter.fontMetrics().height();
+    int y = overlayRect.top() + 6 + painter.fontMetrics().ascent();
+    for (const QString &line : overlay)
+    {
+        painter.drawText(overlayRect.left() + 8, y, line);
+        y += lineHeight;
+    }
 }
\ No newline at end of file
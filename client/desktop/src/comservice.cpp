@@ -1,54 +1,300 @@
 #include "comservice.h"
-#include <climits>
+#include "tcpservice.h"
+#include "udpservice.h"
+#include "uartservice.h"
+#include "shmservice.h"
+#include <algorithm>
 
 /**
- * @brief Extracts a value from the buffer starting at a given position and with a given length.
+ * @brief Constructs the service with the staleness thresholds of the options.
  *
- * @param start The starting position of the value in the buffer.
- * @param length The length of the value to extract.
- * @param value The extracted value.
+ * Both lights share one threshold, they are driven by the same switch.
+ *
+ * @param options The options parsed at startup.
+ */
+COMService::COMService(const Options &options)
+    : staleness{static_cast<uint64_t>(options.staleSpeed) * 1000, static_cast<uint64_t>(options.staleTemperature) * 1000,
+                static_cast<uint64_t>(options.staleBattery) * 1000, static_cast<uint64_t>(options.staleLights) * 1000,
+                static_cast<uint64_t>(options.staleLights) * 1000},
+      revival{std::min({staleness.speed, staleness.temperature, staleness.batteryLevel, staleness.lightLeft, staleness.lightRight})}
+{
+}
+
+/**
+ * @brief Loads the buffer as a little-endian word.
+ *
+ * The buffer is read through the seqlock, so this never blocks the I/O thread.
+ *
+ * @return Codec::Word The word holding the whole frame.
  */
-void COMService::extract(uint32_t start, uint32_t length, uint32_t &value)
+Codec::Word COMService::load(void)
 {
-    value = 0;
-    int pos = start % CHAR_BIT;
-    int index = start / CHAR_BIT;
+    return Codec::load(Buffer.load().data());
+}
+
+/**
+ * @brief Calls the notifier unless a notification is already pending.
+ */
+void COMService::notify(void)
+{
+    if (!pending.exchange(true))
+    {
+        std::scoped_lock<std::mutex> lock(notifierMtx);
+        if (notifier)
+        {
+            notifier();
+        }
+    }
+}
 
-    std::lock_guard<std::mutex> lock(mtx);
+/**
+ * @brief Publishes a frame to the buffer and notifies if any decoded value changed.
+ *
+ * Only the bits used by the signals are compared, so a frame identical to the last one costs no wakeup.
+ * A change is traced with the timestamps of the last packet accepted, the trace is stored before the frame
+ * so that a snapshot showing the frame has its trace.
+ *
+ * The arrival of the frame and the change of every signal are timed for the staleness in the same way.
+ * A frame arriving after a gap longer than the smallest threshold notifies even without a change,
+ * a signal may have been shown as stale meanwhile.
+ *
+ * @param frame The frame received from the vehicle.
+ */
+void COMService::publish(const Codec::Frame &frame)
+{
+    uint64_t now = Protocol::now();
+    Codec::Word word = Codec::load(frame.data());
+    bool changed = (((word ^ last) & Signal::All::MASK) != 0);
+    bool revived = (now - fresh.arrived > revival);
 
-    for (int i = 0; i < length; ++i)
+    auto stamp = [&](Codec::Word mask, uint64_t &time)
     {
-        if (((Buffer[index] >> pos) & 1) != 0)
+        if (((word ^ last) & mask) != 0)
         {
-            value |= (1 << i);
+            time = now;
         }
+    };
+
+    fresh.arrived = now;
+    stamp(Signal::Speed::MASK, fresh.changed.speed);
+    stamp(Signal::Temperature::MASK, fresh.changed.temperature);
+    stamp(Signal::BatteryLevel::MASK, fresh.changed.batteryLevel);
+    stamp(Signal::LightLeft::MASK, fresh.changed.lightLeft);
+    stamp(Signal::LightRight::MASK, fresh.changed.lightRight);
+    freshness.store(fresh);
+
+    if (changed && (candidate.read != 0))
+    {
+        candidate.decoded = now;
+        traced.store(candidate);
+    }
+    candidate = Trace{};
+
+    Buffer.store(frame);
+
+    if (changed)
+    {
+        last = word;
+    }
+    if (changed || revived)
+    {
+        notify();
+    }
+}
+
+/**
+ * @brief Checks the sequence number of a packet and hands it to the observer.
+ *
+ * A gap in the sequence is counted as lost packets, a packet older than the expected one is counted and discarded
+ * so that a late frame never overwrites a newer one. The comparison wraps around with the sequence number.
+ *
+ * The first packet after the link came up is not traced, it may carry a change made long before.
+ *
+ * @param header The header of the packet received.
+ * @param frame The frame carried by the packet.
+ * @param read The monotonic time the packet was read from the link in microseconds.
+ * @return true The packet is the newest so far.
+ * @return false The packet arrived late and must be discarded.
+ */
+bool COMService::accept(const Protocol::Header &header, const Codec::Frame &frame, uint64_t read)
+{
+    Trace trace; /**<No trace until synced*/
+
+    metrics.add(Metrics::FramesReceived);
+    metrics.set(Metrics::LastFrame, read);
+
+    if (synced)
+    {
+        int32_t gap = static_cast<int32_t>(header.sequence - expected);
+
+        if (gap < 0)
+        {
+            metrics.add(Metrics::PacketsReordered);
+            return false;
+        }
+
+        metrics.add(Metrics::PacketsLost, static_cast<uint32_t>(gap));
+        trace = Trace{header.timestamp - header.age, header.timestamp, read, 0};
+    }
+
+    candidate = trace;
+    synced = true;
+    expected = header.sequence + 1;
+    latency = static_cast<int64_t>(Protocol::now() - header.timestamp);
+
+    if (observed)
+    {
+        std::scoped_lock<std::mutex> lock(observerMtx);
+        if (observer)
+        {
+            observer(header, frame);
+        }
+    }
+
+    return true;
+}
+
+/**
+ * @brief Checks the sequence number of a packet and publishes its frame unless it arrived late.
+ *
+ * @param header The header of the packet received.
+ * @param frame The frame carried by the packet.
+ * @param read The monotonic time the packet was read from the link in microseconds.
+ */
+void COMService::publish(const Protocol::Header &header, const Codec::Frame &frame, uint64_t read)
+{
+    if (accept(header, frame, read))
+    {
+        publish(frame);
+    }
+}
+
+/**
+ * @brief Counts a packet that failed to decode, a corrupted one apart from the other failures.
+ *
+ * @param result The reason, anything but Ok, a datagram too short for a packet is invalid as well.
+ */
+void COMService::reject(Protocol::Result result)
+{
+    metrics.add((result == Protocol::Result::BadCrc) ? Metrics::CrcErrors : Metrics::InvalidPackets);
+}
+
+/**
+ * @brief Sets the status of the service and notifies if it changed.
+ *
+ * Services without a connection state machine only know whether frames arrive.
+ *
+ * @param value The new status.
+ */
+void COMService::setStatus(bool value)
+{
+    setState(value ? State::Connected : State::Disconnected);
+}
 
-        pos++;
-        if (pos == CHAR_BIT)
+/**
+ * @brief Sets the state of the connection and notifies if it or the status changed.
+ *
+ * The sequence tracking restarts when the link goes down, the server may restart meanwhile. It is not reset when
+ * the link comes up, the transports accept the first packets before they report the link as connected.
+ * Every time the link comes up but the first one is counted as a reconnect.
+ *
+ * @param value The new state.
+ */
+void COMService::setState(State value)
+{
+    bool connected = (value == State::Connected);
+    bool changed = (state.exchange(value) != value);
+
+    if (status.exchange(connected) != connected)
+    {
+        if (connected && connectedOnce)
         {
-            pos = 0;
-            index++;
+            metrics.add(Metrics::Reconnects);
         }
+        connectedOnce = connectedOnce || connected;
+        synced = synced && connected;
+        changed = true;
+    }
+
+    if (changed)
+    {
+        notify();
     }
 }
 
 /**
- * @brief Extracts a value from the buffer starting at a given position and with a given length.
+ * @brief Sets the callback invoked when a decoded value or the status changed.
  *
- * @param start The starting position of the value in the buffer.
- * @param length The length of the value to extract.
- * @param value The extracted value.
+ * @param callback The callback, or nullptr to stop the notifications.
  */
-void COMService::extract(uint32_t start, uint32_t length, int32_t &value)
+void COMService::setNotifier(std::function<void(void)> callback)
 {
-    extract(start, length, reinterpret_cast<uint32_t &>(value));
+    std::scoped_lock<std::mutex> lock(notifierMtx);
+    notifier = std::move(callback);
+    pending = (notifier != nullptr);
 
-    if ((value & (1 << (length - 1))) != 0)
+    if (notifier)
     {
-        value |= ~((1 << length) - 1);
+        notifier();
     }
 }
 
+/**
+ * @brief Sets the callback invoked from the I/O thread for every packet accepted.
+ *
+ * @param callback The callback, or nullptr to stop the calls.
+ */
+void COMService::setObserver(Observer callback)
+{
+    std::scoped_lock<std::mutex> lock(observerMtx);
+    observer = std::move(callback);
+    observed = (observer != nullptr);
+}
+
+/**
+ * @brief Returns all signals decoded from one copy of the buffer.
+ *
+ * A signal is stale once no frame arrived for longer than its threshold, before the first frame every signal is.
+ * The time until the next fresh signal turns stale is rounded up, so a refresh at that time sees it stale.
+ *
+ * @return Snapshot The decoded signals, their staleness and the status of the service.
+ */
+Snapshot COMService::snapshot(void)
+{
+    Snapshot snap;
+    Codec::Word word = load();
+
+    snap.status = status;
+    snap.state = state;
+    snap.speed = Codec::get<Signal::Speed>(word);
+    snap.temperature = Codec::get<Signal::Temperature>(word);
+    snap.batteryLevel = Codec::get<Signal::BatteryLevel>(word);
+    snap.lightLeft = Codec::get<Signal::LightLeft>(word);
+    snap.lightRight = Codec::get<Signal::LightRight>(word);
+    snap.trace = traced.load();        /**<Loaded after the frame, so it is the trace of this frame or a newer one*/
+    snap.freshness = freshness.load(); /**<Loaded after the frame, so it times this frame or a newer one*/
+
+    uint64_t now = Protocol::now();
+    uint64_t arrived = snap.freshness.arrived;
+    uint64_t age = (arrived == 0) ? UINT64_MAX : ((now > arrived) ? (now - arrived) : 0); /**<The time since the last frame in microseconds*/
+    uint64_t next{UINT64_MAX};                                                            /**<The time until the next fresh signal turns stale*/
+
+    auto check = [&](uint64_t threshold, bool &stale)
+    {
+        stale = (age >= threshold);
+        next = stale ? next : std::min(next, threshold - age);
+    };
+
+    check(staleness.speed, snap.stale.speed);
+    check(staleness.temperature, snap.stale.temperature);
+    check(staleness.batteryLevel, snap.stale.batteryLevel);
+    check(staleness.lightLeft, snap.stale.lightLeft);
+    check(staleness.lightRight, snap.stale.lightRight);
+    snap.nextStale = (next == UINT64_MAX) ? 0 : static_cast<int>((next + 999) / 1000);
+
+    return snap;
+}
+
 /**
  * @brief Returns the speed value from the COMService object.
  *
@@ -56,9 +302,7 @@ void COMService::extract(uint32_t start, uint32_t length, int32_t &value)
  */
 uint32_t COMService::getSpeed(void)
 {
-    uint32_t value;
-    extract(Setting::Signal::Speed::START, Setting::Signal::Speed::LENGTH, value);
-    return value;
+    return get<Signal::Speed>();
 }
 
 /**
@@ -68,9 +312,7 @@ uint32_t COMService::getSpeed(void)
  */
 int32_t COMService::getTemperature(void)
 {
-    int32_t value;
-    extract(Setting::Signal::Temperature::START, Setting::Signal::Temperature::LENGTH, value);
-    return value;
+    return get<Signal::Temperature>();
 }
 
 /**
@@ -80,9 +322,7 @@ int32_t COMService::getTemperature(void)
  */
 uint32_t COMService::getBatteryLevel(void)
 {
-    uint32_t value;
-    extract(Setting::Signal::BatteryLevel::START, Setting::Signal::BatteryLevel::LENGTH, value);
-    return value;
+    return get<Signal::BatteryLevel>();
 }
 
 /**
@@ -92,9 +332,7 @@ uint32_t COMService::getBatteryLevel(void)
  */
 bool COMService::getLightLeft(void)
 {
-    uint32_t value;
-    extract(Setting::Signal::Light::Left::START, Setting::Signal::Light::Left::LENGTH, value);
-    return value;
+    return get<Signal::LightLeft>();
 }
 
 /**
@@ -105,7 +343,29 @@ bool COMService::getLightLeft(void)
 
 bool COMService::getLightRight(void)
 {
-    uint32_t value;
-    extract(Setting::Signal::Light::Right::START, Setting::Signal::Light::Right::LENGTH, value);
-    return value;
-}
\ No newline at end of file
+    return get<Signal::LightRight>();
+}
+
+/**
+ * @brief Creates the transport chosen in the options.
+ *
+ * Every transport is compiled in, the same binary serves a test bench over TCP, UDP or shared memory and a vehicle over UART.
+ *
+ * @param options The options parsed at startup.
+ * @return std::unique_ptr<COMService> The service, its thread is already running.
+ */
+std::unique_ptr<COMService> COMService::create(const Options &options)
+{
+    switch (options.transport)
+    {
+    case Options::Transport::UDP:
+        return std::make_unique<UDPService>(options);
+    case Options::Transport::UART:
+        return std::make_unique<UARTService>(options);
+    case Options::Transport::SHM:
+        return std::make_unique<SHMService>(options);
+    case Options::Transport::TCP:
+    default:
+        return std::make_unique<TCPService>(options);
+    }
+}
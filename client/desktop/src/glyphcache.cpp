@@ -0,0 +1,63 @@
+#include "glyphcache.h"
+#include <QFontMetrics>
+
+/**
+ * @brief Renders a text and caches it.
+ *
+ * The pixmap has the size of the logical bounding box of the text, as used by QPainter::drawText for the alignment.
+ * The cache holds at most CAPACITY texts, inserting one beyond drops the least recently used.
+ *
+ * @param key The key of the text.
+ * @param text The text.
+ * @param font The font.
+ * @param color The color.
+ * @return const GlyphCache::Glyph& The pre-rendered text.
+ */
+const GlyphCache::Glyph &GlyphCache::render(const Key &key, const QString &text, const QFont &font, const QColor &color)
+{
+    QFontMetrics metrics(font);                          /**<Get the font metrics for the text*/
+    QSize size = metrics.size(Qt::TextSingleLine, text); /**<Get the logical size of the text*/
+
+    Glyph *entry = new Glyph;
+    entry->ascent = metrics.ascent();
+    entry->pixmap = QPixmap(size * key.ratio); /**<Allocate the pixmap in device pixels*/
+    entry->pixmap.setDevicePixelRatio(key.ratio);
+    entry->pixmap.fill(Qt::transparent);
+
+    QPainter painter(&entry->pixmap);
+    painter.setRenderHint(QPainter::Antialiasing);
+    painter.setFont(font);
+    painter.setPen(color);
+    painter.drawText(0, entry->ascent, text);
+    painter.end();
+
+    glyphs.insert(key, entry); /**<The cache takes the ownership, the new entry is the most recently used*/
+    return *entry;
+}
+
+/**
+ * @brief Blits a pre-rendered text centered in a rectangle.
+ *
+ * @param painter The painter.
+ * @param rect The rectangle.
+ * @param entry The pre-rendered text.
+ */
+void GlyphCache::blit(QPainter &painter, const QRect &rect, const Glyph &entry)
+{
+    QSizeF size = entry.pixmap.deviceIndependentSize();
+
+    painter.drawPixmap(QPointF(rect.x() + (rect.width() - size.width()) / 2, rect.y() + (rect.height() - size.height()) / 2), entry.pixmap);
+}
+
+/**
+ * @brief Blits a pre-rendered text with its baseline starting at a point.
+ *
+ * @param painter The painter.
+ * @param x The X-coordinate of the start of the baseline.
+ * @param y The Y-coordinate of the baseline.
+ * @param entry The pre-rendered text.
+ */
+void GlyphCache::blit(QPainter &painter, int x, int y, const Glyph &entry)
+{
+    painter.drawPixmap(QPoint(x, y - entry.ascent), entry.pixmap);
+}
@@ -0,0 +1,200 @@
+#include "latency.h"
+#include <QFile>
+#include <QTextStream>
+
+/**
+ * @brief Returns the bucket of a value.
+ *
+ * Values below SUB_COUNT have a bucket each, above that the bucket is given by the position of the highest bit
+ * and the SUB_BITS bits below it.
+ *
+ * @param value The value.
+ * @return int The index of the bucket.
+ */
+int Histogram::index(uint64_t value)
+{
+    if (value < SUB_COUNT)
+    {
+        return static_cast<int>(value);
+    }
+
+    int exponent = 63 - __builtin_clzll(value); /**<The position of the highest bit, at least SUB_BITS*/
+    int mantissa = static_cast<int>(value >> (exponent - SUB_BITS)) & (SUB_COUNT - 1);
+
+    return (exponent - SUB_BITS + 1) * SUB_COUNT + mantissa;
+}
+
+/**
+ * @brief Returns the largest value of a bucket.
+ *
+ * @param index The index of the bucket.
+ * @return uint64_t The upper bound of the bucket, inclusive.
+ */
+uint64_t Histogram::upper(int index)
+{
+    if (index < SUB_COUNT)
+    {
+        return static_cast<uint64_t>(index);
+    }
+
+    int exponent = index / SUB_COUNT + SUB_BITS - 1;
+    uint64_t width = uint64_t{1} << (exponent - SUB_BITS);
+    uint64_t lower = static_cast<uint64_t>(SUB_COUNT + index % SUB_COUNT) << (exponent - SUB_BITS);
+
+    return lower + (width - 1);
+}
+
+/**
+ * @brief Counts a value.
+ *
+ * @param value The value.
+ */
+void Histogram::add(uint64_t value)
+{
+    counts[index(value)]++;
+    total++;
+    maximum = (value > maximum) ? value : maximum;
+}
+
+/**
+ * @brief Returns the value below which a fraction of the values fall.
+ *
+ * @param fraction The fraction, e.g. 0.99 for the 99th percentile.
+ * @return uint64_t The upper bound of the bucket holding the percentile, at most the largest value, 0 without any value.
+ */
+uint64_t Histogram::percentile(double fraction) const
+{
+    uint64_t rank = static_cast<uint64_t>(fraction * total + 0.5); /**<The number of values at or below the percentile*/
+    rank = (rank < 1) ? 1 : rank;
+
+    uint64_t seen{0};
+    for (int i = 0; i < BUCKETS; i++)
+    {
+        seen += counts[i];
+        if (seen >= rank)
+        {
+            uint64_t bound = upper(i);
+            return (bound < maximum) ? bound : maximum;
+        }
+    }
+
+    return maximum;
+}
+
+/**
+ * @brief Returns the name of a stage.
+ *
+ * @param stage The stage.
+ * @return const char* The name, as used in the overlay and the dump.
+ */
+const char *Latency::name(Stage stage)
+{
+    switch (stage)
+    {
+    case Server:
+        return "server";
+    case Transit:
+        return "transit";
+    case Decode:
+        return "decode";
+    case Refresh:
+        return "refresh";
+    case Paint:
+        return "paint";
+    case Total:
+    default:
+        return "total";
+    }
+}
+
+/**
+ * @brief Counts the stages of a frame shown on the canvas.
+ *
+ * A timestamp earlier than the previous one only happens across clocks, the stage is then counted as 0.
+ *
+ * @param trace The timestamps taken by the server and the transport.
+ * @param refreshed The monotonic time the canvas was updated in microseconds.
+ * @param painted The monotonic time the paint completed in microseconds.
+ */
+void Latency::add(const Trace &trace, uint64_t refreshed, uint64_t painted)
+{
+    auto span = [](uint64_t from, uint64_t to)
+    { return (to > from) ? (to - from) : 0; };
+
+    histograms[Server].add(span(trace.changed, trace.sent));
+    histograms[Decode].add(span(trace.read, trace.decoded));
+    histograms[Refresh].add(span(trace.decoded, refreshed));
+    histograms[Paint].add(span(refreshed, painted));
+
+    if ((trace.read >= trace.sent) && (trace.read - trace.sent <= plausible)) /**<No packet travels longer than the timeout*/
+    {
+        histograms[Transit].add(trace.read - trace.sent);
+        histograms[Total].add(span(trace.changed, painted));
+    }
+}
+
+/**
+ * @brief Returns one line per stage with the number of samples, the median, the 99th percentile and the maximum.
+ *
+ * @return QStringList The lines in microseconds, meant for a fixed-pitch font.
+ */
+QStringList Latency::summary(void) const
+{
+    QStringList lines{QString::asprintf("%-8s %7s %7s %7s %8s", "us", "count", "p50", "p99", "max")};
+
+    for (int stage = 0; stage < STAGES; stage++)
+    {
+        const Histogram &h = histograms[stage];
+        lines << QString::asprintf("%-8s %7llu %7llu %7llu %8llu", name(static_cast<Stage>(stage)),
+                                   static_cast<unsigned long long>(h.count()),
+                                   static_cast<unsigned long long>(h.percentile(0.50)),
+                                   static_cast<unsigned long long>(h.percentile(0.99)),
+                                   static_cast<unsigned long long>(h.max()));
+    }
+
+    return lines;
+}
+
+/**
+ * @brief Writes every stage as a JSON line, with its percentiles and its non-empty buckets.
+ *
+ * A bucket is written as [upper bound, count], the durations are in microseconds, e.g.
+ * @code
+ * {"stage":"total","samples":812,"p50_us":1407,"p99_us":3071,"max_us":3302,"buckets":[[1023,12],[1151,40]]}
+ * @endcode
+ *
+ * @param path The path of the file, it is replaced.
+ * @return true The file was written.
+ * @return false The file could not be opened.
+ */
+bool Latency::dump(const QString &path) const
+{
+    QFile file{path};
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text))
+    {
+        return false;
+    }
+
+    QTextStream out{&file};
+    for (int stage = 0; stage < STAGES; stage++)
+    {
+        const Histogram &h = histograms[stage];
+
+        out << "{\"stage\":\"" << name(static_cast<Stage>(stage)) << "\",\"samples\":" << h.count()
+            << ",\"p50_us\":" << h.percentile(0.50) << ",\"p99_us\":" << h.percentile(0.99) << ",\"max_us\":" << h.max()
+            << ",\"buckets\":[";
+
+        bool first{true};
+        for (int i = 0; i < Histogram::BUCKETS; i++)
+        {
+            if (h.at(i) != 0)
+            {
+                out << (first ? "" : ",") << "[" << Histogram::upper(i) << "," << h.at(i) << "]";
+                first = false;
+            }
+        }
+        out << "]}\n";
+    }
+
+    return true;
+}
@@ -0,0 +1,118 @@
+#include "shmservice.h"
+#include "setting.h"
+#include <QDebug>
+
+/**
+ * @brief Reads the ring until the server is silent for too long or the service is stopped.
+ *
+ * It starts with the newest packet, so the current state is shown right away, and then reads every packet
+ * written since it last woke up. If the writer lapped the reader, the overwritten packets are skipped and counted
+ * as lost through their sequence numbers. Each packet is accepted, so the observer sees all of them,
+ * but only the newest frame is published.
+ */
+void SHMService::receive(void)
+{
+    uint64_t tail = region->head.load(std::memory_order_acquire); /**<the position of the next packet to read*/
+    if (tail > 0)
+    {
+        tail--; /**<read the current state*/
+    }
+
+    while (!end) /**<run until the end flag is set*/
+    {
+        uint32_t bell = region->doorbell.load();                      /**<read before the head, a packet written meanwhile rings it*/
+        uint64_t head = region->head.load(std::memory_order_acquire); /**<the number of packets written*/
+
+        if (end)
+        {
+            return;
+        }
+
+        if (head == tail)
+        {
+            if (!ShmRing::wait(*region, bell, options.timeout()) && (region->head.load() == tail))
+            {
+                return; /**<the server is silent, map the object again*/
+            }
+            continue;
+        }
+
+        if (head - tail > ShmRing::CAPACITY)
+        {
+            tail = head - ShmRing::CAPACITY; /**<the writer lapped the reader*/
+        }
+
+        uint64_t read = Protocol::now(); /**<the time the batch was read*/
+        Protocol::Header header;         /**<the header of the packet*/
+        Codec::Frame tmparr{0};          /**<create a temporary array to store the data*/
+        Codec::Frame newest{0};          /**<the newest frame of the batch*/
+        bool fresh{false};               /**<true if the batch holds a frame newer than the published one*/
+
+        metrics.set(Metrics::QueueDepth, head - tail);
+
+        for (; tail < head; tail++)
+        {
+            Protocol::Packet packet = region->slots[tail % ShmRing::CAPACITY].load();
+            Protocol::Result result = Protocol::decode(packet.data(), packet.size(), header, tmparr.data());
+
+            metrics.add(Metrics::BytesReceived, packet.size());
+
+            if (result != Protocol::Result::Ok)
+            {
+                reject(result);
+            }
+            else if ((header.sequence == static_cast<uint32_t>(tail)) && accept(header, tmparr, read)) /**<skip a slot overwritten meanwhile*/
+            {
+                newest = tmparr;
+                fresh = true;
+            }
+        }
+
+        if (fresh)
+        {
+            setState(State::Connected); /**<set the state to connected*/
+            publish(newest);            /**<publish the data to the buffer*/
+        }
+    }
+}
+
+/**
+ * @brief This function runs the SHM service and reads the frames of the server.
+ *
+ * @details It maps the shared memory object named in the options and reads the ring until the server is silent
+ * for too long, then maps the object again. While the server is not running, it tries again every
+ * Setting::Client::BACKOFF_MIN milliseconds. It runs until the end flag is set to true.
+ *
+ * @param None.
+ *
+ * @return None.
+ */
+void SHMService::run(void)
+{
+    while (!end) /**<run until the end flag is set*/
+    {
+        setState(State::Connecting); /**<set the state to connecting*/
+
+        {
+            std::scoped_lock<std::mutex> locker{mtx};
+            region = end ? nullptr : ShmRing::map(options.shm.toLatin1().constData(), false);
+        }
+
+        if (region != nullptr)
+        {
+            receive(); /**<read until the server is silent or the service is stopped*/
+
+            std::scoped_lock<std::mutex> locker{mtx};
+            ShmRing::unmap(region);
+            region = nullptr;
+        }
+
+        if (!end)
+        {
+            setState(State::Backoff);                                                             /**<set the state to waiting*/
+            std::this_thread::sleep_for(std::chrono::milliseconds(Setting::Client::BACKOFF_MIN)); /**<wait for the server*/
+        }
+    }
+
+    setState(State::Disconnected); /**<set the state to disconnected*/
+}
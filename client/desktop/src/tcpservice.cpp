@@ -1,66 +1,199 @@
 #include "tcpservice.h"
 #include "setting.h"
-#include "canvas.h"
 #include <arpa/inet.h>
+#include <poll.h>
+#include <cerrno>
+#include <algorithm>
+#include <cstring>
+#include <array>
 #include <QDebug>
 
 /**
- * @brief This function runs the TCP service and connects to the server.
- *
- * @details It creates a socket and connects to the server using the IP address and port number specified in the Setting namespace.
- * It then receives data from the server and stores it in the Buffer array until the end flag is set to true.
+ * @brief Waits until the socket is ready, the timeout expires or the service is stopped.
  *
- * @note This function is a member function of the TCPService class.
+ * The eventfd written by the destructor is polled as well, so the service never sleeps through a shutdown.
  *
- * @param None.
+ * @param events The poll events to wait for on the socket, or 0 to only wait for the timeout.
+ * @param timeout The timeout in milliseconds.
+ * @return short The poll events returned for the socket, 0 on timeout or when the service is stopped.
+ */
+short TCPService::await(short events, int timeout)
+{
+    pollfd fds[2]{{event_fd, POLLIN, 0}, {socket_fd, events, 0}};
+    int count = poll(fds, (events != 0) ? 2 : 1, timeout);
+
+    if ((count <= 0) || (fds[0].revents != 0) || end)
+    {
+        return 0; /**<Timed out, interrupted or stopped*/
+    }
+
+    return fds[1].revents;
+}
+
+/**
+ * @brief Creates a non-blocking socket and connects it to the server within the timeout.
  *
- * @return None.
+ * @param address The address of the server.
+ * @return true The connection is established.
+ * @return false The socket could not be created, the server refused or did not answer in time.
  */
-void TCPService::run(void)
+bool TCPService::open(const sockaddr_in &address)
 {
-    sockaddr_in server_address{0}; /**<The server address.*/
+    socket_fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0); // create socket
+    if (socket_fd == -1)
+    {
+        return false;
+    }
 
-    server_address.sin_family = AF_INET;                                               /**<Sets the address family.*/
-    server_address.sin_port = htons(Setting::tcp_connection::tcp_port::PORT);          /**<Sets the port number which is defined in the shared setting.h file.*/
-    inet_pton(AF_INET, Setting::tcp_connection::tcp_ip::IP, &server_address.sin_addr); /**<Sets the IP address which is defined in the shared setting.h file.*/
+    if (0 == ::connect(socket_fd, (const struct sockaddr *)&address, sizeof(address))) /**<Connected right away, e.g. on loopback*/
+    {
+        return true;
+    }
+
+    if (errno != EINPROGRESS)
+    {
+        return false;
+    }
+
+    int error{0};
+    socklen_t length{sizeof(error)};
+
+    return (0 != (await(POLLOUT, options.timeout()) & POLLOUT)) &&
+           (0 == getsockopt(socket_fd, SOL_SOCKET, SO_ERROR, &error, &length)) && (error == 0); /**<The result of the connection*/
+}
+
+/**
+ * @brief Receives packets until the connection is lost, times out or the service is stopped.
+ *
+ * The server sends at least every heartbeat, so nothing received within the timeout means the connection is lost.
+ * Every wakeup pulls all the bytes available with a single recv and decodes every complete packet in them.
+ * Each packet is accepted, so the observer sees all of them, but only the newest frame is published.
+ * A packet split across two reads is kept at the front of the buffer until the rest arrives, the read is counted as short.
+ *
+ * @return true if at least one valid packet was received before the connection ended.
+ */
+bool TCPService::receive(void)
+{
+    std::array<uint8_t, RECV_SIZE> buffer; /**<the bytes received and not decoded yet*/
+    size_t size{0};                        /**<the number of bytes in the buffer*/
+    bool valid{false};                     /**<true once a packet passed the checks of the protocol*/
 
     while (!end) /**<run until the end flag is set*/
     {
+        short events = await(POLLIN, options.timeout());
 
-        do // try to connect
+        if (events == 0)
         {
-            socket_fd = socket(AF_INET, SOCK_STREAM, 0); // create socket
-            if (socket_fd == -1)                         // check if socket was created
-            {
-                continue; /**<Try again*/
-            }
-            if (0 == ::connect(socket_fd, (struct sockaddr *)&server_address, sizeof(server_address))) /**<Try to connect*/
+            if (!end)
             {
-                status = true; /**<set the status flag to true*/
+                qDebug() << "TCP read timeout. Connection may be lost.";
             }
-            else
+            return valid;
+        }
+
+        ssize_t n = recv(socket_fd, buffer.data() + size, buffer.size() - size, 0);
+
+        if (n <= 0)
+        {
+            if ((n < 0) && ((errno == EAGAIN) || (errno == EWOULDBLOCK) || (errno == EINTR)))
             {
-                status = false;   /**<set the status flag to false*/
-                close(socket_fd); // close socket
-                continue;         /**<Try again*/
+                continue; /**<Spurious wakeup*/
             }
-        } while (!status && !end); /**<run until the status flag is true or the end flag is set*/
+            return valid; /**<The server closed the connection or it failed*/
+        }
+        size += n;
+        uint64_t read = Protocol::now(); /**<the time the batch was read*/
+        metrics.add(Metrics::BytesReceived, n);
 
-        while (!end) /**<run until the end flag is set*/
+        Protocol::Header header; /**<the header of the packet*/
+        Codec::Frame tmparr{0};  /**<create a temporary array to store the data*/
+        Codec::Frame newest{0};  /**<the newest frame of the batch*/
+        bool fresh{false};       /**<true if the batch holds a frame newer than the published one*/
+        size_t offset{0};        /**<the start of the next packet in the buffer*/
+
+        for (; size - offset >= static_cast<size_t>(Protocol::PACKET_SIZE); offset += Protocol::PACKET_SIZE)
         {
-            uint8_t tmparr[sizeof(Buffer)]{0}; /**<create a temporary array to store the data*/
+            Protocol::Result result = Protocol::decode(buffer.data() + offset, Protocol::PACKET_SIZE, header, tmparr.data());
 
-            if (sizeof(Buffer) == read(socket_fd, tmparr, sizeof(Buffer))) /**<read the data*/
+            if (result != Protocol::Result::Ok)
             {
-                std::scoped_lock<std::mutex> lock(mtx); /**<lock the mutex*/
-                memcpy(Buffer, tmparr, sizeof(Buffer)); /**<copy the data to the buffer*/
+                qDebug() << "Invalid packet, reconnecting. Error:" << static_cast<int>(result); /**<the stream is out of sync*/
+                reject(result);
+                return valid;
             }
-            else
+
+            valid = true;
+
+            if (accept(header, tmparr, read))
             {
-                close(socket_fd); /**<close the socket*/
-                status = false;   /**<set the status flag to false*/
-                break;            /**<break the loop*/
+                newest = tmparr;
+                fresh = true;
             }
         }
+
+        size -= offset;
+        std::memmove(buffer.data(), buffer.data() + offset, size); /**<keep the partial packet for the next read*/
+        metrics.set(Metrics::QueueDepth, offset / Protocol::PACKET_SIZE);
+        metrics.add(Metrics::ShortReads, (size != 0) ? 1 : 0);
+
+        if (fresh)
+        {
+            setState(State::Connected); /**<set the state to connected*/
+            publish(newest);            /**<publish the data to the buffer*/
+        }
+    }
+
+    return valid;
+}
+
+/**
+ * @brief This function runs the TCP service and connects to the server.
+ *
+ * @details It connects to the server using the IP address and port number given in the options
+ * and receives packets from it until the connection is lost. It then waits before trying again, the delay starts at
+ * Setting::Client::BACKOFF_MIN and doubles after every failed attempt up to Setting::Client::BACKOFF_MAX. A connection
+ * only counts as a success once a valid packet is received, so a server that accepts and then drops or garbles the
+ * connection is not retried in a tight loop.
+ * The state of the connection is published for the GUI. It runs until the end flag is set to true.
+ *
+ * @note This function is a member function of the TCPService class.
+ *
+ * @param None.
+ *
+ * @return None.
+ */
+void TCPService::run(void)
+{
+    sockaddr_in server_address{0}; /**<The server address.*/
+
+    server_address.sin_family = AF_INET;                                               /**<Sets the address family.*/
+    server_address.sin_port = htons(options.tcpPort);                                  /**<Sets the port number given in the options.*/
+    inet_pton(AF_INET, options.host.toLatin1().constData(), &server_address.sin_addr); /**<Sets the IP address given in the options.*/
+
+    int backoff{Setting::Client::BACKOFF_MIN}; /**<The delay before the next attempt in milliseconds.*/
+
+    while (!end) /**<run until the end flag is set*/
+    {
+        setState(State::Connecting); /**<set the state to connecting*/
+
+        if (open(server_address) && receive()) /**<receive until the connection is lost*/
+        {
+            backoff = Setting::Client::BACKOFF_MIN; /**<the server sent valid data, retry quickly next time*/
+        }
+
+        if (socket_fd != -1)
+        {
+            close(socket_fd); /**<close the socket*/
+            socket_fd = -1;
+        }
+
+        if (!end)
+        {
+            setState(State::Backoff);                                      /**<set the state to waiting*/
+            await(0, backoff);                                             /**<wait, the destructor interrupts the wait*/
+            backoff = std::min(backoff * 2, Setting::Client::BACKOFF_MAX); /**<wait longer next time*/
+        }
     }
+
+    setState(State::Disconnected); /**<set the state to disconnected*/
 }
@@ -15,15 +15,18 @@
  * @brief Runs the UARTService thread.
  *
  * This function sets up the serial port with the specified settings and continuously reads data from it until the 'end' flag is set.
- * The data is stored in a buffer and a mutex is used to ensure thread safety.
+ * The bytes are fed to a Protocol::Parser as they arrive, so a packet split over several reads is reassembled
+ * and a corrupted byte only costs the packets around it, the port stays open.
+ * The data is published to the buffer through a seqlock, so the GUI thread never blocks the reader.
  *
  */
 void UARTService::run(void)
 {
     QSerialPort serial_port; /**<The serial port object.*/
+    Protocol::Parser parser; /**<The parser splitting the byte stream into packets.*/
 
-    serial_port.setPortName(Setting::UART_Connection::PORT);     /**<Sets the serial prot which is defined in the shared setting.h file*/
-    serial_port.setBaudRate(Setting::UART_Connection::BAUDRATE); /**<Sets the baud rate which is defined in the shared setting.h file*/
+    serial_port.setPortName(options.device);                     /**<Sets the serial port given in the options*/
+    serial_port.setBaudRate(options.baudrate);                   /**<Sets the baud rate given in the options*/
     serial_port.setParity(QSerialPort::NoParity);                /**<Sets the parity.*/
     serial_port.setDataBits(QSerialPort::Data8);                 /**<Sets the data bits.*/
     serial_port.setStopBits(QSerialPort::OneStop);               /**<Sets the stop bits.*/
@@ -33,38 +36,62 @@ void UARTService::run(void)
     {
         if (serial_port.open(QIODevice::ReadOnly)) /**<open the serial port*/
         {
+            parser.reset(); /**<forget the bytes of the previous connection*/
+
             while (!end && serial_port.isReadable()) /**<read until the end flag is set or the serial port is not readable*/
             {
-                serial_port.clear();               /**<clear the serial port*/
-                uint8_t tmparr[sizeof(Buffer)]{0}; /**<create a temporary array to store the data*/
+                uint8_t chunk[Protocol::Parser::CAPACITY]; /**<create a temporary array to store the bytes*/
+                Protocol::Header header;                   /**<the header of the packet*/
+                Codec::Frame tmparr{0};                    /**<create a temporary array to store the data*/
+                Codec::Frame newest{0};                    /**<the newest frame of the batch*/
+                bool fresh{false};                         /**<true if the batch holds a frame newer than the published one*/
 
-                if (serial_port.waitForReadyRead(Setting::INTERVAL)) /**<wait for data to be available*/
+                if ((serial_port.bytesAvailable() == 0) && !serial_port.waitForReadyRead(options.timeout())) /**<wait for data to be available, the server sends at least every heartbeat*/
                 {
-                    if (sizeof(tmparr) == serial_port.read(reinterpret_cast<char *>(tmparr), sizeof(tmparr))) /**<read the data*/
-                    {
-                        status = true;                          /**<set the status flag to true*/
-                        std::scoped_lock<std::mutex> lock(mtx); /**<lock the mutex*/
-                        memcpy(Buffer, tmparr, sizeof(Buffer)); /**<copy the data to the buffer*/
-                    }
-                    else
+                    qDebug() << "UART read timeout. Connection may be lost."; /**<print an error message*/
+                    setStatus(false);                                         /**<set the status flag to false*/
+                    break;                                                    /**<break the loop*/
+                }
+
+                qint64 count = serial_port.read(reinterpret_cast<char *>(chunk), parser.space()); /**<read whatever arrived, at most what the parser can hold*/
+                if (count < 0)
+                {
+                    qDebug() << "UART read error. Connection may be lost."; /**<print an error message*/
+                    setStatus(false);                                       /**<set the status flag to false*/
+                    break;                                                  /**<break the loop*/
+                }
+
+                parser.feed(chunk, count);                  /**<accumulate the bytes*/
+                uint64_t read = Protocol::now();            /**<the time the bytes were read*/
+                uint32_t corrupted = parser.getCorrupted(); /**<the packets failing the CRC before this read*/
+                uint64_t batch{0};                          /**<the number of packets in this read*/
+                metrics.add(Metrics::BytesReceived, count);
+
+                while (parser.next(header, tmparr.data())) /**<extract every complete packet, the observer sees all of them*/
+                {
+                    batch++;
+                    if (accept(header, tmparr, read))
                     {
-                        qDebug() << "UART read error. Connection may be lost."; /**<print an error message*/
-                        status = false;                                         /**<set the status flag to false*/
-                        break;                                                  /**<break the loop*/
+                        newest = tmparr;
+                        fresh = true;
                     }
                 }
-                else
+
+                metrics.add(Metrics::CrcErrors, parser.getCorrupted() - corrupted);
+                metrics.add(Metrics::ShortReads, (parser.space() != Protocol::Parser::CAPACITY) ? 1 : 0); /**<a partial packet is left*/
+                metrics.set(Metrics::QueueDepth, batch);
+
+                if (fresh)
                 {
-                    qDebug() << "UART read timeout. Connection may be lost."; /**<print an error message*/
-                    status = false;                                           /**<set the status flag to false*/
-                    break;                                                    /**<break the loop*/
+                    setStatus(true); /**<set the status flag to true*/
+                    publish(newest); /**<publish only the newest frame to the buffer*/
                 }
             }
         }
         else
         {
             qDebug() << "Failed to open the port"; /**<print an error message*/
-            status = false;                        /**<set the status flag to false*/
+            setStatus(false);                      /**<set the status flag to false*/
         }
 
         if (serial_port.isOpen()) /**<close the serial port*/
@@ -0,0 +1,178 @@
+#include "udpservice.h"
+#include "setting.h"
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <cerrno>
+#include <QDebug>
+
+/**
+ * @brief Creates the UDP socket, binds it to the port and joins the multicast group.
+ *
+ * The address is reused so that several clients on the same host can subscribe at once.
+ * If the address in the options is not a multicast group, the socket simply receives unicast datagrams.
+ *
+ * @return true The socket is ready to receive.
+ * @return false The socket could not be created, bound or could not join the group.
+ */
+bool UDPService::open(void)
+{
+    int enable{1};
+    ip_mreq membership{};
+
+    sockaddr_in address{0};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(options.udpPort);
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+
+    inet_pton(AF_INET, options.group.toLatin1().constData(), &membership.imr_multiaddr);
+    inet_pton(AF_INET, options.interface.toLatin1().constData(), &membership.imr_interface);
+
+    socket_fd = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (socket_fd == -1)
+    {
+        return false;
+    }
+
+    if ((0 != setsockopt(socket_fd, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable))) ||
+        (0 != bind(socket_fd, (struct sockaddr *)&address, sizeof(address))))
+    {
+        return false;
+    }
+
+    if (IN_MULTICAST(ntohl(membership.imr_multiaddr.s_addr)) &&
+        (0 != setsockopt(socket_fd, IPPROTO_IP, IP_ADD_MEMBERSHIP, &membership, sizeof(membership))))
+    {
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * @brief Receives datagrams until the server is silent for too long, the socket fails or the service is stopped.
+ *
+ * Every wakeup takes all the datagrams queued with a single recvmmsg, each one holds a packet.
+ * Each packet is accepted, so the observer sees all of them, but only the newest frame is published.
+ * A datagram that is not a valid packet is ignored, it does not affect the others.
+ */
+void UDPService::receive(void)
+{
+    Protocol::Packet packets[BATCH]; /**<the packets of a batch*/
+    iovec vectors[BATCH];            /**<the buffers of the datagrams*/
+    mmsghdr messages[BATCH];         /**<the datagrams of a batch*/
+
+    for (int i = 0; i < BATCH; i++)
+    {
+        vectors[i] = {packets[i].data(), packets[i].size()};
+        messages[i] = {};
+        messages[i].msg_hdr.msg_iov = &vectors[i];
+        messages[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    while (!end) /**<run until the end flag is set*/
+    {
+        pollfd fds[2]{{event_fd, POLLIN, 0}, {socket_fd, POLLIN, 0}};
+        int ready = poll(fds, 2, options.timeout());
+
+        if ((ready < 0) && (errno == EINTR))
+        {
+            continue;
+        }
+        if ((ready < 0) || (fds[0].revents != 0) || end)
+        {
+            return; /**<The poll failed or the service is stopped*/
+        }
+        if (ready == 0)
+        {
+            setState(State::Connecting); /**<the server is silent, wait for it*/
+            continue;
+        }
+
+        int count = recvmmsg(socket_fd, messages, BATCH, MSG_DONTWAIT, nullptr);
+        if (count < 0)
+        {
+            if ((errno == EAGAIN) || (errno == EWOULDBLOCK) || (errno == EINTR))
+            {
+                continue; /**<Spurious wakeup*/
+            }
+            return; /**<The socket failed*/
+        }
+
+        uint64_t read = Protocol::now(); /**<the time the batch was read*/
+        Protocol::Header header;         /**<the header of the packet*/
+        Codec::Frame tmparr{0};          /**<create a temporary array to store the data*/
+        Codec::Frame newest{0};          /**<the newest frame of the batch*/
+        bool fresh{false};               /**<true if the batch holds a frame newer than the published one*/
+
+        metrics.set(Metrics::QueueDepth, count);
+
+        for (int i = 0; i < count; i++)
+        {
+            Protocol::Result result = Protocol::decode(packets[i].data(), messages[i].msg_len, header, tmparr.data());
+
+            metrics.add(Metrics::BytesReceived, messages[i].msg_len);
+            metrics.add(Metrics::ShortReads, (messages[i].msg_len < static_cast<unsigned>(Protocol::PACKET_SIZE)) ? 1 : 0);
+
+            if (result != Protocol::Result::Ok)
+            {
+                reject(result); /**<a short datagram is rejected as well*/
+            }
+            else if (accept(header, tmparr, read))
+            {
+                newest = tmparr;
+                fresh = true;
+            }
+        }
+
+        if (fresh)
+        {
+            setState(State::Connected); /**<set the state to connected*/
+            publish(newest);            /**<publish the data to the buffer*/
+        }
+    }
+}
+
+/**
+ * @brief This function runs the UDP service and subscribes to the frames of the server.
+ *
+ * @details It opens the socket with the port and group given in the options and receives packets
+ * until the socket fails, then waits Setting::Client::BACKOFF_MIN before opening it again.
+ * The state is connecting until the first packet arrives and whenever the server is silent for too long.
+ * It runs until the end flag is set to true.
+ *
+ * @param None.
+ *
+ * @return None.
+ */
+void UDPService::run(void)
+{
+    while (!end) /**<run until the end flag is set*/
+    {
+        setState(State::Connecting); /**<set the state to connecting*/
+
+        if (open())
+        {
+            receive(); /**<receive until the socket fails or the service is stopped*/
+        }
+        else
+        {
+            qDebug() << "Failed to open the UDP socket";
+        }
+
+        if (socket_fd != -1)
+        {
+            close(socket_fd); /**<close the socket*/
+            socket_fd = -1;
+        }
+
+        if (!end)
+        {
+            pollfd wakeup{event_fd, POLLIN, 0};
+            setState(State::Backoff);                       /**<set the state to waiting*/
+            poll(&wakeup, 1, Setting::Client::BACKOFF_MIN); /**<wait, the destructor interrupts the wait*/
+        }
+    }
+
+    setState(State::Disconnected); /**<set the state to disconnected*/
+}
@@ -1,21 +1,24 @@
 #include "window.h"
 #include "setting.h"
+#include <QKeyEvent>
 
 /**
  * @brief Constructor for the Window class.
  *
  * This constructor sets the window flags to always stay on top, sets the window title to "Client",
  * adds the canvas to the layout, sets the layout margins to 0, sets the canvas size policy to fixed,
- * sets the canvas width and height from the shared header file, connects the timer's timeout signal
- * to the refresh slot, and starts the timer with an interval of 1000 ms (1 second).
+ * sets the canvas width and height from the shared header file, and registers a notifier on the
+ * communication module so the canvas is refreshed only when a decoded value or the status changed,
+ * or when a signal turns stale.
  *
- * @param None.
+ * @param com The transport the values are taken from.
+ * @param options The options, the refreshes are spaced by the maximum frame rate in them.
  * @return None.
  *
  * @note This constructor is called when a Window object is created.
  *
  */
-Window::Window(COMService *com) : communication{com}
+Window::Window(COMService *com, const Options &options) : frameInterval{1000 / options.maxFps}, communication{com}, latency{options.timeout()}
 {
     setWindowFlags(Qt::WindowStaysOnTopHint); /**<Set the window to be always on top*/
     setWindowTitle("Client");                 /**<Set the window title*/
@@ -28,28 +31,107 @@ Window::Window(COMService *com) : communication{com}
     canvas.setFixedWidth(Setting::Client::Windows::Width);        /**<Set the canvas width from the shared setting.h file*/
     canvas.setFixedHeight(Setting::Client::Windows::Height);      /**<Set the canvas height from the shared setting.h file*/
 
-    /**<Connect the timer's timeout signal to the refresh slot*/
+    /**<Connect the timer's timeout signal to the refresh slot, the timer only fires to honor the maximum frame rate*/
+    timer.setSingleShot(true);
     connect(&timer, &QTimer::timeout, this, &Window::refresh);
+    staleTimer.setSingleShot(true);
+    connect(&staleTimer, &QTimer::timeout, this, &Window::refresh);
+    elapsed.start();
+    overlayAge.start();
 
-    /**<Set the timer interval (in milliseconds) the interval is defined in the shared setting.h file*/
-    timer.start(Setting::INTERVAL); /**<Start the timer*/
+    /**<The latency of a change ends when the canvas painted it*/
+    canvas.setPainted([this]()
+                      { painted(); });
+
+    /**<The notifier runs on the I/O thread, queue the refresh to the GUI thread*/
+    communication->setNotifier([this]()
+                               { QMetaObject::invokeMethod(this, [this]()
+                                                           { schedule(); }, Qt::QueuedConnection); });
+}
+
+/**
+ * @brief Destructor for the Window class.
+ *
+ * Stops the notifications before the window is destroyed, as the communication module outlives it.
+ */
+Window::~Window()
+{
+    communication->setNotifier(nullptr);
+    canvas.setPainted(nullptr);
+}
+
+/**
+ * @brief Toggles the latency overlay on F3, other keys are handled by the dialog.
+ *
+ * @param event The key press event.
+ */
+void Window::keyPressEvent(QKeyEvent *event)
+{
+    if (event->key() != Qt::Key_F3)
+    {
+        QDialog::keyPressEvent(event);
+        return;
+    }
+
+    overlayShown = !overlayShown;
+    canvas.setOverlay(overlayShown ? overlayLines() : QStringList{});
+    overlayAge.restart();
+}
+
+/**
+ * @brief Refreshes the canvas now, or once the minimum frame interval has passed.
+ *
+ * The maximum frame rate defaults to the shared setting.h file and is set with --max-fps.
+ */
+void Window::schedule()
+{
+    communication->acknowledge(); /**<Allow the next change to notify again*/
+
+    qint64 wait = frameInterval - elapsed.elapsed(); /**<Time left until the next refresh is allowed*/
+
+    if (wait <= 0)
+    {
+        refresh();
+    }
+    else if (!timer.isActive())
+    {
+        timer.start(static_cast<int>(wait));
+    }
 }
 
 /**
  * @brief Refreshes the window by updating the canvas with the latest data received from the communication module.
  *
- * This function updates the battery level, temperature, speed, light, and status of the canvas by calling the corresponding functions of the communication module.
+ * This function takes a snapshot of all signals from the communication module, so every value shown comes from the same frame,
+ * and updates the battery level, temperature, speed, light, and status of the canvas with it.
+ * The readings whose frames stopped arriving are greyed out, the stale timer refreshes again when the next one turns stale.
  * It then triggers the repaint of the canvas by calling the update() function.
  */
 void Window::refresh()
 {
-    if (communication->getStatus()) /**<Check if the communication module is connected */
+    elapsed.restart();
+
+    Snapshot snap = communication->snapshot(); /**<Take all signals from the same frame*/
+
+    if ((snap.trace.read != 0) && (snap.trace.decoded != lastDecoded)) /**<A new change was traced, time it until painted*/
     {
-        canvas.setBatteryLevel(communication->getBatteryLevel());                       /**<Set the Battery Level*/
-        canvas.setTemperature(communication->getTemperature());                         /**<Set the Temperature*/
-        canvas.setSpeed(communication->getSpeed());                                     /**<Set the Speed*/
-        canvas.setLight(communication->getLightLeft(), communication->getLightRight()); /**<Set the Light*/
-        canvas.setStatus(true);                                                         /**<Set the Status*/
+        pending = snap.trace;
+        refreshed = Protocol::now();
+        lastDecoded = snap.trace.decoded;
+    }
+
+    if (snap.status) /**<Check if the communication module is connected */
+    {
+        canvas.setBatteryLevel(snap.batteryLevel);        /**<Set the Battery Level*/
+        canvas.setTemperature(snap.temperature);          /**<Set the Temperature*/
+        canvas.setSpeed(snap.speed);                      /**<Set the Speed*/
+        canvas.setLight(snap.lightLeft, snap.lightRight); /**<Set the Light*/
+        canvas.setStatus(true);                           /**<Set the Status*/
+
+        canvas.setBatteryStale(snap.stale.batteryLevel);                   /**<Grey out the Battery Level if stale*/
+        canvas.setTemperatureStale(snap.stale.temperature);                /**<Grey out the Temperature if stale*/
+        canvas.setSpeedStale(snap.stale.speed);                            /**<Grey out the Speed if stale*/
+        canvas.setLightStale(snap.stale.lightLeft, snap.stale.lightRight); /**<Grey out the Light if stale*/
     }
     else /**<If the communication module is not connected*/
     {
@@ -58,7 +140,65 @@ void Window::refresh()
         canvas.setTemperature(0);  /**<Set the Temperature*/
         canvas.setSpeed(0);        /**<Set the Speed*/
         canvas.setLight(0, 0);     /**<Set the Light*/
+
+        /**<The status tells the link is lost already, the zeroes are not greyed out*/
+        canvas.setBatteryStale(false);
+        canvas.setTemperatureStale(false);
+        canvas.setSpeedStale(false);
+        canvas.setLightStale(false, false);
+
+        canvas.setStatusText((snap.state == State::Connecting) ? Canvas::StatusText::Connecting : Canvas::StatusText::NoSignal); /**<Show whether a connection is being attempted*/
+    }
+
+    if (snap.status && (snap.nextStale > 0)) /**<No frame may arrive until then, so the refresh is timed*/
+    {
+        staleTimer.start(snap.nextStale);
+    }
+    else
+    {
+        staleTimer.stop();
     }
 
     canvas.update(); /**<Trigger the repaint of the canvas*/
 }
+
+/**
+ * @brief Counts the latency of the pending change once the canvas painted it and updates the overlay.
+ *
+ * The overlay is updated at most every OVERLAY_PERIOD, so it does not cause a paint of its own for every change.
+ */
+void Window::painted()
+{
+    if (refreshed != 0)
+    {
+        latency.add(pending, refreshed, Protocol::now());
+        refreshed = 0;
+    }
+
+    if (overlayShown && (overlayAge.elapsed() >= Setting::Client::OVERLAY_PERIOD))
+    {
+        canvas.setOverlay(overlayLines());
+        overlayAge.restart();
+    }
+}
+
+/**
+ * @brief Returns the lines of the overlay, the latency of every stage followed by the health of the link.
+ *
+ * The metrics are atomics of the transport, reading them never blocks its I/O thread.
+ *
+ * @return QStringList The lines.
+ */
+QStringList Window::overlayLines(void) const
+{
+    const Metrics::Registry &metrics = communication->getMetrics();
+    QStringList lines = latency.summary();
+
+    lines << QString::asprintf("link     rx %llu lost %llu crc %llu reconnects %llu",
+                               static_cast<unsigned long long>(metrics.get(Metrics::FramesReceived)),
+                               static_cast<unsigned long long>(metrics.get(Metrics::PacketsLost)),
+                               static_cast<unsigned long long>(metrics.get(Metrics::CrcErrors)),
+                               static_cast<unsigned long long>(metrics.get(Metrics::Reconnects)));
+
+    return lines;
+}
\ No newline at end of file
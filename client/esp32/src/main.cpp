@@ -2,8 +2,10 @@
 #include <CAN.h>
 #include <CAN_config.h>
 #include "setting.h"
+#include "protocol.h"
 
 CAN_device_t CAN_cfg; /**<CAN config*/
+uint32_t sequence{0}; /**<The sequence number of the next packet*/
 
 void setup()
 {
@@ -28,6 +30,8 @@ void loop()
 
     if (pdTRUE == xQueueReceive(CAN_cfg.rx_queue, &frame, portMAX_DELAY)) /**<Receive the data from the CAN bus*/
     {
-        Serial.write(frame.data.u8, Setting::Signal::BUFSIZE); /**<Send the data to the serial port*/
+        Protocol::Packet packet;                                                       /**<The packet sent to the serial port*/
+        Protocol::encode(frame.data.u8, sequence++, esp_timer_get_time(), 0, packet); /**<Wrap the data, the timestamp is the time since boot, the frame was just received*/
+        Serial.write(packet.data(), packet.size());                                    /**<Send the packet to the serial port*/
     }
 }
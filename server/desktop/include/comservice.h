@@ -4,35 +4,157 @@
  *
  * This file contains the declaration of the COMService class, which is responsible for handling communication with external devices.
  * The class provides methods for setting various parameters such as speed, temperature, battery level, and lights.
- * It also contains a protected buffer for storing signals and a mutex for thread safety.
+ * It also contains a protected buffer for storing signals, shared with the I/O thread through a seqlock.
+ * The frames of a replay are handed over one at a time, each one is written to the link before the next one.
  */
 #ifndef COMSERVICE_H
 #define COMSERVICE_H
 
 #include <cstdint>
-#include <mutex>
+#include <algorithm>
 #include <atomic>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
 #include "setting.h"
+#include "codec.h"
+#include "seqlock.h"
+#include "options.h"
+#include "protocol.h"
+#include "metrics.h"
 
 class COMService
 {
-    void insert(uint32_t start, uint32_t length, uint32_t value);
+    bool connectedOnce{false}; /**<True once the link was up, so the next time it comes up is a reconnect.*/
 
 protected:
-    std::mutex mtx;
     std::atomic<bool> status{false};
-    uint8_t Buffer[Setting::Signal::BUFSIZE]{0};
+    SeqLock<Codec::Frame> Buffer;       /**<The frame sent to the client, written by the GUI thread only.*/
+    std::atomic<uint64_t> changed{0};   /**<The monotonic time the frame last changed in microseconds, stored before the frame.*/
+    Metrics::Registry metrics;          /**<The health of the link, counted by the I/O thread and read from any thread.*/
+    std::atomic<uint64_t> submitted{0}; /**<The number of frames handed over by setFrame, stored after the frame.*/
+    uint64_t delivered{0};              /**<The last frame of setFrame written completely to the link, guarded by deliveryMutex.*/
+    std::mutex deliveryMutex;           /**<Mutex to protect the delivered count.*/
+    std::condition_variable deliveryCv; /**<Condition variable to wake up setFrame when its frame is delivered.*/
 
     virtual void run(void) = 0;
 
+    /**
+     * @brief Sets the status, every time the link comes up but the first one is counted as a reconnect.
+     * @note Called from the I/O thread only.
+     * @param value The new status.
+     */
+    void setStatus(bool value)
+    {
+        if ((status.exchange(value) != value) && value)
+        {
+            metrics.add(Metrics::Reconnects, connectedOnce ? 1 : 0);
+            connectedOnce = true;
+        }
+    }
+
+    /**
+     * @brief Counts what was written to the link.
+     * @param frames The number of packets written completely.
+     * @param bytes The number of bytes written.
+     */
+    void sent(uint64_t frames, uint64_t bytes)
+    {
+        metrics.add(Metrics::FramesSent, frames);
+        metrics.add(Metrics::BytesSent, bytes);
+        if (frames != 0)
+        {
+            metrics.set(Metrics::LastFrame, Protocol::now());
+        }
+    }
+
+    /**
+     * @brief Called by the setters when the frame changed, wakes up the I/O thread so the frame is sent right away.
+     */
+    virtual void notify(void) {}
+
+    /**
+     * @brief Reports that a packet was written completely to the link, wakes up setFrame if it waits for it.
+     * @note Called by the transports, from any thread.
+     * @param generation The generation returned by pack for the packet.
+     */
+    void deliver(uint64_t generation)
+    {
+        {
+            std::scoped_lock<std::mutex> locker{deliveryMutex};
+            delivered = std::max(delivered, generation);
+        }
+        deliveryCv.notify_all();
+    }
+
+    /**
+     * @brief Wraps the current frame in a packet, stamped with the time it is sent and the time since it changed.
+     * @param sequence The sequence number of the packet.
+     * @param packet The packet.
+     * @return The generation of the frame, passed to deliver once the packet is written.
+     */
+    uint64_t pack(uint32_t sequence, Protocol::Packet &packet)
+    {
+        uint64_t generation = submitted.load(std::memory_order_acquire); // Loaded before the frame, so the frame is at least as new
+        Codec::Frame frame = Buffer.load();
+        uint64_t since = changed.load(std::memory_order_acquire); // Loaded after the frame, so it is at least as new
+        uint64_t now = Protocol::now();
+        Protocol::encode(frame.data(), sequence, now, Protocol::age(since, now), packet);
+        return generation;
+    }
+
 public:
     bool getStatus(void) { return status; }
+
+    /**
+     * @brief Returns the health of the link, the counters can be read from any thread without a lock.
+     * @return The metrics of the transport.
+     */
+    const Metrics::Registry &getMetrics(void) const { return metrics; }
+
     void setSpeed(uint32_t value);
     void setTemperature(uint32_t value);
     void setBatteryLevel(uint32_t value);
     void SetLightLeft(bool value);
     void SetLightRight(bool value);
 
+    /**
+     * @brief Sets the value of a signal in the buffer and notifies the I/O thread if the frame changed.
+     * @note The setters must all be called from the same thread, the seqlock allows a single writer.
+     * @tparam S The descriptor of the signal, e.g. Signal::Speed.
+     * @param value The value of the signal.
+     */
+    template <typename S>
+    void set(typename S::type value)
+    {
+        Codec::Frame frame = Buffer.load();
+        Codec::Word word = Codec::load(frame.data());
+        Codec::Word updated = Codec::set<S>(word, value);
+
+        if (updated != word)
+        {
+            Codec::store(updated, frame.data());
+            changed.store(Protocol::now(), std::memory_order_release); // The start of the end-to-end latency
+            Buffer.store(frame);
+            notify();
+        }
+    }
+
+    /**
+     * @brief Replaces the whole frame and waits until the transport wrote it to the link, used by the replay.
+     * @note Returns without any delivery guarantee while the link is down, e.g. without any TCP client.
+     * @note Must not be mixed with the setters, the seqlock allows a single writer.
+     * @param frame The frame to send.
+     */
+    void setFrame(const Codec::Frame &frame);
+
+    /**
+     * @brief Creates the transport chosen in the options, its thread starts right away.
+     * @param options The options parsed at startup.
+     * @return The service.
+     */
+    static std::unique_ptr<COMService> create(const Options &options);
+
     virtual ~COMService() = default;
 };
 
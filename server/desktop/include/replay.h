@@ -0,0 +1,37 @@
+/**
+ * @file replay.h
+ * @brief Header file for the Replay class, which streams a recording through a COMService instead of the sliders.
+ *
+ * The recording is a frame log written by the client with --record, see framelog.h. The frames are sent with the
+ * timing they were received with, scaled by a speed factor, or as fast as the transport takes them, never merged.
+ * It runs without a window, so the server can load a client or reproduce a recorded session from a script.
+ *
+ * @see COMService
+ */
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include <QString>
+#include <cstdint>
+#include "comservice.h"
+#include "framelog.h"
+
+class Replay
+{
+private:
+    COMService &service;  /**<The transport the frames are sent through.*/
+    FrameLog::Reader log; /**<The mapped recording.*/
+    const double speed;   /**<The speed factor, 0 to send as fast as possible.*/
+
+public:
+    /**<Constructor declaration, the frames are sent through the given service at the given speed.*/
+    Replay(COMService &com, double factor) : service{com}, speed{factor} {}
+
+    /**<Maps the recording, returns false if it is not a frame log.*/
+    bool open(const QString &path);
+
+    /**<Waits for the transport to be up, sends every frame of the recording and returns the number of frames sent.*/
+    uint64_t run(void);
+};
+
+#endif // REPLAY_H
@@ -0,0 +1,65 @@
+/**
+ * @file shmservice.h
+ * @brief Header file for the SHMService class, which inherits from COMService.
+ *
+ * This class hands the frames over to the clients on the same host through a shared memory ring, see shmring.h.
+ * A changed frame is pushed to the ring right away by the setter, so it costs no thread switch nor system call
+ * unless a client sleeps on the doorbell. The thread only repeats the frame every heartbeat, so that the clients
+ * can tell a quiet vehicle from a stopped server.
+ *
+ * @see COMService
+ */
+#ifndef SHMSERVICE_H
+#define SHMSERVICE_H
+
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include "comservice.h"
+#include "options.h"
+#include "shmring.h"
+
+class SHMService : public COMService
+{
+private:
+    const Options options;            /**<The name of the shared memory object and the heartbeat.*/
+    ShmRing::Region *region{nullptr}; /**<The mapped ring, nullptr until it is created.*/
+    std::mutex mtx;                   /**<Mutex serializing the writers of the ring, the setters and the heartbeat.*/
+    std::condition_variable cv;       /**<Condition variable to wake up the thread when the service stops.*/
+    std::atomic<bool> end{false};     /**<Atomic flag to indicate when the service should stop.*/
+
+    /**<Defines a thread that runs the "run" function upon creation of a SHMService object.*/
+    std::thread thrd{&SHMService::run, this};
+
+    /**<Declaration of the overriden "run" function which is expected to provide the main functionality.*/
+    void run(void) override;
+
+    /**<Pushes the changed frame to the ring.*/
+    void notify(void) override;
+
+public:
+    /**<Constructor declaration, the thread starts right away with the given options.*/
+    explicit SHMService(const Options &opts) : options{opts} {}
+
+    /**<Destructor declaration.
+        It ensures that when a SHMService object is destroyed, the associated thread is joined
+        and the shared memory object is removed.
+    */
+    ~SHMService()
+    {
+        {
+            std::scoped_lock<std::mutex> locker{mtx};
+            end = true;
+        }
+        cv.notify_one();
+        thrd.join();
+
+        if (region != nullptr)
+        {
+            ShmRing::unmap(region);
+            shm_unlink(options.shm.toLatin1().constData());
+        }
+    }
+};
+
+#endif // SHMSERVICE_H
@@ -7,17 +7,41 @@
 #include <netinet/in.h>
 #include <unistd.h>
 #include "comservice.h"
+#include "protocol.h"
+#include "options.h"
 #include <sys/socket.h>
+#include <sys/eventfd.h>
+#include <unordered_map>
 #include <thread>
+#include <deque>
 
 /**
  * @brief The TCPService class is a COMService that communicates with the vehicle via TCP.
+ *
+ * Any number of clients can be connected at once, every frame is fanned out to all of them.
+ * Each client has its own non-blocking send queue, so a slow client does not stall the others.
+ * Frames are sent as soon as a setter changes the buffer, and at least every heartbeat of the options.
+ * Every frame is wrapped in a Protocol packet, all clients see the same sequence numbers.
  */
 class TCPService : public COMService /**<Declares a new class named "TCPService" that inherits from "COMService".*/
 {
 private:
-    int socket_fd;                /**<File descriptor for the TCP socket.*/
-    std::atomic<bool> end{false}; /**<Atomic flag to indicate when the service should stop.*/
+    /**<The state of a connected client.*/
+    struct Client
+    {
+        std::deque<Protocol::Packet> queue; /**<Packets waiting to be sent, the front one may be partially sent.*/
+        size_t offset{0};                   /**<Number of bytes of the front packet already sent.*/
+        bool writable{true};                /**<False while the socket buffer is full and EPOLLOUT is armed.*/
+    };
+
+    const Options options;                                /**<The address, port and heartbeat, declared before the thread that reads them.*/
+    int socket_fd{-1};                                    /**<File descriptor for the listening TCP socket.*/
+    int epoll_fd{-1};                                     /**<File descriptor for the epoll instance.*/
+    int event_fd{eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)}; /**<File descriptor written by the setters to wake up the I/O thread.*/
+    std::unordered_map<int, Client> clients;              /**<The connected clients keyed by their socket, accessed by the I/O thread only.*/
+    uint32_t sequence{0};                                 /**<The sequence number of the next packet, accessed by the I/O thread only.*/
+    uint64_t pending{0};                                  /**<The generation of the last packet broadcast, delivered once every queue is empty.*/
+    std::atomic<bool> end{false};                         /**<Atomic flag to indicate when the service should stop.*/
 
     /**<Defines a thread that runs the "run" function upon creation of a TCPService object.*/
     std::thread thrd{&TCPService::run, this};
@@ -25,20 +49,38 @@ private:
     /**<Declaration of the overriden "run" function which is expected to provide the main functionality.*/
     void run(void) override;
 
+    /**<Creates the listening socket and the epoll instance, returns false on failure.*/
+    bool open(void);
+
+    /**<Accepts all pending connections.*/
+    void acceptAll(void);
+
+    /**<Queues the current frame to every client in a new packet and sends as much as possible.*/
+    void broadcast(void);
+
+    /**<Sends the queued packets of a client until its socket buffer is full, returns false if the client is gone.*/
+    bool flush(int fd, Client &client);
+
+    /**<Closes the connection to a client.*/
+    void drop(int fd);
+
+    /**<Wakes up the I/O thread to send the changed frame.*/
+    void notify(void) override;
+
 public:
-    /**<Default constructor declaration.*/
-    TCPService() = default;
+    /**<Constructor declaration, the thread starts right away with the given options.*/
+    explicit TCPService(const Options &opts) : options{opts} {}
 
     /**<Destructor declaration.
         It ensures that when a TCPService object is destroyed,
-        the socket is shutdown and closed, and the associated thread is joined.
+        the associated thread is joined, the thread closes every socket before it returns.
     */
     ~TCPService()
     {
-        end = true;                     /**<Set the "end" flag to true to indicate the service should stop.*/
-        shutdown(socket_fd, SHUT_RDWR); /**<Shutdown both reading and writing on the socket.*/
-        close(socket_fd);               /**<Close the socket.*/
-        thrd.join();                    /**<Wait for the associated thread to finish.*/
+        end = true;      /**<Set the "end" flag to true to indicate the service should stop.*/
+        notify();        /**<Wake up the thread.*/
+        thrd.join();     /**<Wait for the associated thread to finish.*/
+        close(event_fd); /**<Close the wakeup file descriptor.*/
     }
 };
 
@@ -3,8 +3,9 @@
  * @brief Header file for the UARTService class, which inherits from COMService and QThread.
  *
  * This class provides a UART service for communication between devices. It overrides the run() function
- * from QThread to start the service in a separate thread. The service can be stopped by setting the end flag
- * to true and waiting for the thread to finish.
+ * from QThread to start the service in a separate thread. The thread sleeps on a condition variable until a setter
+ * changes the frame or the heartbeat expires. The service can be stopped by setting the end flag
+ * to true, waking up the thread and waiting for it to finish.
  *
  * @see COMService
  * @see QThread
@@ -13,18 +14,35 @@
 #define UARTSERVICE_H
 
 #include <QThread>
+#include <mutex>
+#include <condition_variable>
 #include "comservice.h"
+#include "options.h"
 
 class UARTService : public COMService, public QThread
 {
 private:
+    const Options options;        /**<The serial port, baud rate and heartbeat.*/
     std::atomic<bool> end{false}; /**<Atomic flag to indicate when the service should stop.*/
+    std::mutex mtx;               /**<Mutex to protect the changed flag.*/
+    std::condition_variable cv;   /**<Condition variable to wake up the thread when the frame changed.*/
+    bool changed{false};          /**<Flag to indicate that the frame changed since it was last sent.*/
 
     void run() override; /**<Override the run() function from QThread to provide the main functionality.*/
 
+    /**<Wakes up the thread to send the changed frame.*/
+    void notify(void) override
+    {
+        {
+            std::scoped_lock<std::mutex> locker{mtx};
+            changed = true;
+        }
+        cv.notify_one();
+    }
+
 public:
     /**>Constructor declaration.*/
-    UARTService()
+    explicit UARTService(const Options &opts) : options{opts}
     {
         start();
     }
@@ -34,6 +52,7 @@ public:
     virtual ~UARTService()
     {
         end = true;
+        notify();
         wait();
     }
 };
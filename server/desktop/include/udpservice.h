@@ -0,0 +1,66 @@
+/**
+ * @file udpservice.h
+ * @brief Header file for the UDPService class, which inherits from COMService.
+ *
+ * This class publishes the frames as UDP datagrams to a multicast group, so any number of clients can subscribe
+ * without the server keeping any state per client. The thread sleeps on a condition variable until a setter
+ * changes the frame or the heartbeat expires, like the UARTService.
+ *
+ * @see COMService
+ */
+#ifndef UDPSERVICE_H
+#define UDPSERVICE_H
+
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <netinet/in.h>
+#include "comservice.h"
+#include "options.h"
+
+class UDPService : public COMService
+{
+private:
+    const Options options;        /**<The group, interface, port and heartbeat, declared before the thread that reads them.*/
+    int socket_fd{-1};            /**<File descriptor for the UDP socket.*/
+    sockaddr_in destination{};    /**<The multicast group or unicast address the frames are sent to.*/
+    std::atomic<bool> end{false}; /**<Atomic flag to indicate when the service should stop.*/
+    std::mutex mtx;               /**<Mutex to protect the changed flag.*/
+    std::condition_variable cv;   /**<Condition variable to wake up the thread when the frame changed.*/
+    bool changed{false};          /**<Flag to indicate that the frame changed since it was last sent.*/
+
+    /**<Defines a thread that runs the "run" function upon creation of a UDPService object.*/
+    std::thread thrd{&UDPService::run, this};
+
+    /**<Declaration of the overriden "run" function which is expected to provide the main functionality.*/
+    void run(void) override;
+
+    /**<Creates the socket and sets the multicast options, returns false on failure.*/
+    bool open(void);
+
+    /**<Wakes up the thread to send the changed frame.*/
+    void notify(void) override
+    {
+        {
+            std::scoped_lock<std::mutex> locker{mtx};
+            changed = true;
+        }
+        cv.notify_one();
+    }
+
+public:
+    /**<Constructor declaration, the thread starts right away with the given options.*/
+    explicit UDPService(const Options &opts) : options{opts} {}
+
+    /**<Destructor declaration.
+        It ensures that when a UDPService object is destroyed, the associated thread is joined.
+    */
+    ~UDPService()
+    {
+        end = true;
+        notify();
+        thrd.join();
+    }
+};
+
+#endif // UDPSERVICE_H
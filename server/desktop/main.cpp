@@ -1,14 +1,17 @@
 #include <QApplication>
+#include <QCoreApplication>
+#include <QDebug>
 #include "window.h"
-#ifdef UARTCOM
-#include "uartservice.h"
-#else
-#include "tcpservice.h"
-#endif
+#include "options.h"
+#include "replay.h"
+#include "metrics.h"
 
 /**
  * @file main.cpp
- * @brief Entry point of the application. Initializes the QApplication and the service used by the Window.
+ * @brief Entry point of the application. Initializes the QApplication and the service chosen in the options, used by the Window.
+ *
+ * With --replay, a recording is streamed through the service instead and the application exits when it is done.
+ * With --metrics, the health of the transport is served on a loopback port in the Prometheus text format.
  *
  * @param argc Number of command line arguments.
  * @param argv Array of command line arguments.
@@ -16,17 +19,46 @@
  */
 int main(int argc, char *argv[])
 {
-    QApplication app(argc, argv);
+    // A replay runs without a window, whether it is given on the command line or in the config file
+    std::unique_ptr<QCoreApplication> app{Options::peek(argc, argv, "replay").isEmpty() ? new QApplication(argc, argv) : new QCoreApplication(argc, argv)};
+
+    Options options;
+    QString error;
+
+    if (!options.parse(*app, Options::Role::Server, error))
+    {
+        qCritical().noquote() << error;
+        return 1;
+    }
+
+    std::unique_ptr<COMService> service = COMService::create(options);
+
+    Metrics::Exporter exporter; // Declared after the service, so it stops serving before the service is destroyed
+    const std::string labels = std::string{"role=\"server\",transport=\""} + options.transportName() + "\"";
+
+    if ((options.metrics != 0) && !exporter.open(options.metrics, [&service, labels]()
+                                                 { return service->getMetrics().format(labels); }))
+    {
+        qCritical().noquote() << "Cannot serve the metrics on port" << options.metrics;
+        return 1;
+    }
+
+    if (!options.replay.isEmpty())
+    {
+        Replay replay{*service, options.speed};
+        if (!replay.open(options.replay))
+        {
+            qCritical().noquote() << "Cannot read the recording:" << options.replay;
+            return 1;
+        }
 
-#ifdef UARTCOM
-    UARTService service;
-#else
-    TCPService service;
-#endif
+        qDebug() << "Frames replayed:" << replay.run();
+        return 0;
+    }
 
-    Window clientWindow{&service};
+    Window clientWindow{service.get()};
 
     clientWindow.show();
 
-    return app.exec();
+    return app->exec();
 }
@@ -4,42 +4,10 @@
  */
 
 #include "comservice.h"
-#include "setting.h"
-#include <climits>
-
-/**
- * @brief Inserts a value into the buffer starting at the specified position.
- *
- * @param start The starting bit position in the buffer.
- * @param length The number of bits to insert.
- * @param value The value to insert.
- */
-void COMService::insert(const uint32_t start, const uint32_t length, uint32_t value)
-{
-    int pos = start % CHAR_BIT;
-    int index = start / CHAR_BIT;
-    std::scoped_lock<std::mutex> locker{mtx};
-    for (size_t i = 0; i < length; i++)
-    {
-        uint8_t bit = (uint8_t)((value >> i) & 1);
-
-        if (bit == 0)
-        {
-            Buffer[index] &= ~(1 << pos);
-        }
-        else
-        {
-            Buffer[index] |= (1 << pos);
-        }
-
-        pos++;
-        if (pos == CHAR_BIT)
-        {
-            pos = 0;
-            index++;
-        }
-    }
-}
+#include "tcpservice.h"
+#include "udpservice.h"
+#include "uartservice.h"
+#include "shmservice.h"
 
 /**
  * @brief Sets the speed value in the buffer.
@@ -48,7 +16,7 @@ void COMService::insert(const uint32_t start, const uint32_t length, uint32_t va
  */
 void COMService::setSpeed(uint32_t value)
 {
-    insert(Setting::Signal::Speed::START, Setting::Signal::Speed::LENGTH, value);
+    set<Signal::Speed>(value);
 }
 
 /**
@@ -58,7 +26,7 @@ void COMService::setSpeed(uint32_t value)
  */
 void COMService::setTemperature(uint32_t value)
 {
-    insert(Setting::Signal::Temperature::START, Setting::Signal::Temperature::LENGTH, value);
+    set<Signal::Temperature>(value);
 }
 
 /**
@@ -68,7 +36,7 @@ void COMService::setTemperature(uint32_t value)
  */
 void COMService::setBatteryLevel(uint32_t value)
 {
-    insert(Setting::Signal::BatteryLevel::START, Setting::Signal::BatteryLevel::LENGTH, value);
+    set<Signal::BatteryLevel>(value);
 }
 
 /**
@@ -78,8 +46,7 @@ void COMService::setBatteryLevel(uint32_t value)
  */
 void COMService::SetLightLeft(bool data)
 {
-    uint32_t value = data ? 1U : 0;
-    insert(Setting::Signal::Light::Left::START, Setting::Signal::Light::Left::LENGTH, value);
+    set<Signal::LightLeft>(data);
 }
 
 /**
@@ -89,6 +56,56 @@ void COMService::SetLightLeft(bool data)
  */
 void COMService::SetLightRight(bool data)
 {
-    uint32_t value = data ? 1U : 0;
-    insert(Setting::Signal::Light::Right::START, Setting::Signal::Light::Right::LENGTH, value);
-}
\ No newline at end of file
+    set<Signal::LightRight>(data);
+}
+
+/**
+ * @brief Replaces the whole frame and waits until it is written to the link.
+ *
+ * The frame is sent even if it did not change, and the call returns only once the transport reported the packet
+ * carrying it as written, so no frame of a replay is merged with the next one. It returns right away when the link
+ * is down, e.g. when the last client disconnected, so the replay never blocks on nobody. There is no delivery
+ * guarantee then, the frame may have reached no one.
+ *
+ * @param frame The frame to send.
+ */
+void COMService::setFrame(const Codec::Frame &frame)
+{
+    if (frame != Buffer.load())
+    {
+        changed.store(Protocol::now(), std::memory_order_release);
+    }
+    Buffer.store(frame);
+    uint64_t generation = submitted.fetch_add(1, std::memory_order_release) + 1; // Stored after the frame
+    notify();
+
+    std::unique_lock<std::mutex> locker{deliveryMutex};
+    while ((delivered < generation) && status)
+    {
+        deliveryCv.wait_for(locker, std::chrono::milliseconds(Setting::INTERVAL)); // The status is polled, it does not notify
+    }
+}
+
+/**
+ * @brief Creates the transport chosen in the options.
+ *
+ * Every transport is compiled in, the same binary serves a test bench over TCP, UDP or shared memory and a vehicle over UART.
+ *
+ * @param options The options parsed at startup.
+ * @return std::unique_ptr<COMService> The service, its thread is already running.
+ */
+std::unique_ptr<COMService> COMService::create(const Options &options)
+{
+    switch (options.transport)
+    {
+    case Options::Transport::UDP:
+        return std::make_unique<UDPService>(options);
+    case Options::Transport::UART:
+        return std::make_unique<UARTService>(options);
+    case Options::Transport::SHM:
+        return std::make_unique<SHMService>(options);
+    case Options::Transport::TCP:
+    default:
+        return std::make_unique<TCPService>(options);
+    }
+}
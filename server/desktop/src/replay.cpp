@@ -0,0 +1,71 @@
+/**
+ * @file replay.cpp
+ * @brief Implementation of the Replay class.
+ *
+ * The frames are paced by the time the client received them, which is monotonic even across a restart of the
+ * recorded server, so the replay reproduces the gaps and bursts the client saw. Every frame is handed to the
+ * transport even if it did not change, and setFrame waits until the transport wrote it, so no frame is merged
+ * with the next one and every recorded frame reaches the clients, in order.
+ */
+#include "replay.h"
+#include "setting.h"
+#include <QDebug>
+#include <chrono>
+#include <cstring>
+#include <thread>
+
+/**
+ * @brief Maps the recording.
+ *
+ * @param path The path of the frame log.
+ * @return true The recording is ready.
+ * @return false The file does not exist or is not a frame log of this version.
+ */
+bool Replay::open(const QString &path)
+{
+    return log.open(path.toLocal8Bit().constData());
+}
+
+/**
+ * @brief Streams the recording.
+ *
+ * It waits until the transport is up, i.e. a client is connected for TCP, so that no frame is sent to nobody.
+ * Each frame is then sent at its offset from the first one divided by the speed, a late frame is sent right away
+ * and the following ones keep their original schedule. With a speed of 0 the frames are sent back to back, as fast as
+ * the transport writes them. It returns once the last frame is written, so the service can be destroyed right away.
+ *
+ * @return uint64_t The number of frames sent.
+ */
+uint64_t Replay::run(void)
+{
+    const uint64_t count = log.count();
+    if (count == 0)
+    {
+        return 0;
+    }
+
+    while (!service.getStatus())
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(Setting::INTERVAL));
+    }
+
+    const uint64_t origin = log.at(0).received;
+    const auto start = std::chrono::steady_clock::now();
+
+    for (uint64_t i = 0; i < count; i++)
+    {
+        const FrameLog::Record &record = log.at(i);
+
+        if (speed > 0)
+        {
+            std::chrono::duration<double, std::micro> offset{(record.received - origin) / speed};
+            std::this_thread::sleep_until(start + std::chrono::duration_cast<std::chrono::microseconds>(offset));
+        }
+
+        Codec::Frame frame;
+        std::memcpy(frame.data(), record.frame, frame.size());
+        service.setFrame(frame); // Returns once the frame is written to the link
+    }
+
+    return count;
+}
@@ -0,0 +1,64 @@
+/**
+ * @file shmservice.cpp
+ * @brief Implementation of the SHMService class.
+ *
+ * The service creates the shared memory object named in the options and pushes every frame to its ring.
+ */
+#include "shmservice.h"
+#include "setting.h"
+#include <QDebug>
+
+/**
+ * @brief Pushes the changed frame to the ring, called by the setters.
+ *
+ * The setter thread writes the ring itself, the clients see the frame as soon as this returns, so it is delivered right away.
+ */
+void SHMService::notify(void)
+{
+    std::scoped_lock<std::mutex> locker{mtx};
+    if (region != nullptr)
+    {
+        uint64_t generation = submitted.load(std::memory_order_acquire); // Loaded before the frame, like pack
+        Codec::Frame frame = Buffer.load();
+        ShmRing::push(*region, frame.data(), changed.load()); // Loaded after the frame, so it is at least as new
+        sent(1, Protocol::PACKET_SIZE);
+        deliver(generation);
+    }
+}
+
+/**
+ * @brief This function runs the SHM service.
+ *
+ * It creates the shared memory object, then pushes the buffer at least every heartbeat until the 'end' flag is set.
+ * The status is true as long as the object is mapped, whether any client reads it or not.
+ *
+ * @return void
+ */
+void SHMService::run(void)
+{
+    std::unique_lock<std::mutex> locker{mtx};
+
+    while (!end)
+    {
+        if (region == nullptr)
+        {
+            region = ShmRing::map(options.shm.toLatin1().constData(), true);
+            setStatus(region != nullptr);
+
+            if (region == nullptr)
+            {
+                qDebug() << "Failed to create the shared memory object";
+                cv.wait_for(locker, std::chrono::milliseconds(Setting::INTERVAL), [this]
+                            { return end.load(); }); // try again
+                continue;
+            }
+        }
+
+        Codec::Frame frame = Buffer.load();
+        ShmRing::push(*region, frame.data(), changed.load());
+        sent(1, Protocol::PACKET_SIZE);
+
+        cv.wait_for(locker, std::chrono::milliseconds(options.heartbeat), [this]
+                    { return end.load(); });
+    }
+}
@@ -1,87 +1,336 @@
 /**
- * @brief This function runs the TCP service.
- *
- * It creates a socket and binds it to the specified IP address and port number.
- * It listens for incoming connections and accepts them.
- * It sends the buffer to the client until the 'end' flag is set.
+ * @file tcpservice.cpp
+ * @brief Implementation of the TCPService class.
  *
- * @return void
+ * The service listens for any number of clients and fans each frame out to all of them.
+ * The sockets are non-blocking and multiplexed with epoll, every client has its own bounded send queue.
+ * The setters wake up the I/O thread through an eventfd, so a change is sent immediately.
+ * Frames are wrapped in Protocol packets, so the clients can detect loss and measure the latency.
  */
 #include "tcpservice.h"
 #include "setting.h"
 #include <arpa/inet.h>
+#include <sys/epoll.h>
 #include <QDebug>
-#include <ostream>
+#include <chrono>
+#include <cerrno>
+#include <algorithm>
 
-void TCPService::run(void)
+/**
+ * @brief Creates the non-blocking listening socket and the epoll instance.
+ *
+ * @return true The socket listens for connections.
+ * @return false The socket could not be created, bound or set to listen.
+ */
+bool TCPService::open(void)
 {
-    bool enable{0};
+    int enable{1};
 
     sockaddr_in server_address{0};
     server_address.sin_family = AF_INET;
-    server_address.sin_port = htons(Setting::tcp_connection::tcp_port::PORT);
-    inet_pton(AF_INET, Setting::tcp_connection::tcp_ip::IP, &server_address.sin_addr);
+    server_address.sin_port = htons(options.tcpPort);
+    inet_pton(AF_INET, options.host.toLatin1().constData(), &server_address.sin_addr);
 
-    while (!end) // Continue until 'end' flag is set
+    socket_fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (socket_fd == -1)
+    {
+        return false;
+    }
+
+    if ((setsockopt(socket_fd, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable)) < 0) ||
+        (0 != bind(socket_fd, (struct sockaddr *)&server_address, sizeof(server_address))) ||
+        (0 != ::listen(socket_fd, SOMAXCONN)))
+    {
+        close(socket_fd);
+        socket_fd = -1;
+        return false;
+    }
+
+    epoll_event event{0};
+    event.events = EPOLLIN;
+    event.data.fd = socket_fd;
+
+    epoll_event wakeup{0};
+    wakeup.events = EPOLLIN;
+    wakeup.data.fd = event_fd;
+
+    epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if ((epoll_fd == -1) || (0 != epoll_ctl(epoll_fd, EPOLL_CTL_ADD, socket_fd, &event)) ||
+        (0 != epoll_ctl(epoll_fd, EPOLL_CTL_ADD, event_fd, &wakeup)))
+    {
+        if (epoll_fd != -1)
+        {
+            close(epoll_fd);
+            epoll_fd = -1;
+        }
+        close(socket_fd);
+        socket_fd = -1;
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * @brief Accepts all pending connections and registers them with epoll.
+ *
+ * The clients are only watched for hang-ups and incoming data, EPOLLOUT is armed when their send queue backs up.
+ */
+void TCPService::acceptAll(void)
+{
+    while (true)
+    {
+        int connfd = accept4(socket_fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (connfd < 0)
+        {
+            break; // No more pending connections (EAGAIN) or a transient error
+        }
+
+        epoll_event event{0};
+        event.events = EPOLLIN | EPOLLRDHUP;
+        event.data.fd = connfd;
+
+        if (0 != epoll_ctl(epoll_fd, EPOLL_CTL_ADD, connfd, &event))
+        {
+            close(connfd);
+            continue;
+        }
+
+        Client &client = clients[connfd];
+        client.queue.emplace_back();
+        pack(sequence - 1, client.queue.back()); // Send the current state right away, the others do not see a gap
+        if (!flush(connfd, client))
+        {
+            drop(connfd);
+            continue;
+        }
+        qDebug() << "Client connected, clients:" << clients.size();
+    }
+
+    setStatus(!clients.empty());
+}
+
+/**
+ * @brief Sends the queued packets of a client until the queue is empty or the socket buffer is full.
+ *
+ * @param fd The socket of the client.
+ * @param client The state of the client.
+ * @return true The client is still connected.
+ * @return false The connection failed, the client must be dropped.
+ */
+bool TCPService::flush(int fd, Client &client)
+{
+    while (!client.queue.empty())
     {
-        do
+        const Protocol::Packet &packet = client.queue.front();
+        ssize_t n = send(fd, packet.data() + client.offset, packet.size() - client.offset, MSG_NOSIGNAL);
+
+        if (n < 0)
         {
-            socket_fd = socket(AF_INET, SOCK_STREAM, 0);
-            if (socket_fd == -1)
+            if ((errno == EAGAIN) || (errno == EWOULDBLOCK))
             {
-                continue; // try again
+                break; // The socket buffer is full, wait for EPOLLOUT
             }
-            else
+            return false;
+        }
+
+        client.offset += n;
+        sent((client.offset == packet.size()) ? 1 : 0, n);
+        if (client.offset == packet.size())
+        {
+            client.queue.pop_front();
+            client.offset = 0;
+        }
+    }
+
+    bool writable = client.queue.empty();
+    if (writable != client.writable)
+    {
+        epoll_event event{0};
+        event.events = EPOLLIN | EPOLLRDHUP | (writable ? 0 : EPOLLOUT);
+        event.data.fd = fd;
+        if (0 != epoll_ctl(epoll_fd, EPOLL_CTL_MOD, fd, &event))
+        {
+            return false; // Without EPOLLOUT the queue would never be flushed
+        }
+        client.writable = writable;
+    }
+
+    return true;
+}
+
+/**
+ * @brief Wraps the current frame in a packet, queues it to every client and sends as much as each socket accepts.
+ *
+ * When the queue of a slow client is full, the oldest packet that is not partially sent is dropped,
+ * so the client always catches up with the latest state and sees the gap in the sequence.
+ * The frame counts as delivered once the queues of all the clients are empty, see run().
+ */
+void TCPService::broadcast(void)
+{
+    Protocol::Packet packet;
+    pending = pack(sequence++, packet);
+
+    for (auto it = clients.begin(); it != clients.end();)
+    {
+        Client &client = it->second;
+
+        if (client.queue.size() >= static_cast<size_t>(Setting::Server::MAX_QUEUE))
+        {
+            client.queue.erase(client.queue.begin() + ((client.offset > 0) ? 1 : 0));
+        }
+        client.queue.push_back(packet);
+
+        int fd = it->first;
+        ++it;
+        if (!flush(fd, client))
+        {
+            qDebug() << "Connection lost ... dropping client";
+            drop(fd);
+        }
+    }
+}
+
+/**
+ * @brief Closes the connection to a client and forgets its queue.
+ *
+ * @param fd The socket of the client.
+ */
+void TCPService::drop(int fd)
+{
+    epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+    close(fd);
+    clients.erase(fd);
+
+    setStatus(!clients.empty());
+}
+
+/**
+ * @brief Wakes up the I/O thread, called by the setters when the frame changed.
+ */
+void TCPService::notify(void)
+{
+    uint64_t one{1};
+    if (sizeof(one) != write(event_fd, &one, sizeof(one)))
+    {
+        qDebug() << "Failed to wake up the TCP service";
+    }
+}
+
+/**
+ * @brief This function runs the TCP service.
+ *
+ * It creates a non-blocking socket, binds it to the specified IP address and port number and listens for incoming connections.
+ * It accepts any number of clients and sends the buffer to all of them as soon as it changes,
+ * and at least every heartbeat to keep the connections alive, until the 'end' flag is set.
+ * Once at least one client is connected and the queues of all of them are empty, the last frame broadcast is
+ * reported as delivered to setFrame. Without any client nothing is delivered, setFrame returns because the link is down.
+ *
+ * @return void
+ */
+void TCPService::run(void)
+{
+    constexpr int MAX_EVENTS{32};
+    const auto period = std::chrono::milliseconds(options.heartbeat); // Keep-alive, frames are otherwise sent on change
+
+    if (event_fd == -1)
+    {
+        qDebug() << "Failed to create the wakeup eventfd, the TCP service does not start";
+        return;
+    }
+
+    while (!end && !open())
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(Setting::INTERVAL)); // try again
+    }
+
+    auto next = std::chrono::steady_clock::now();
+    epoll_event events[MAX_EVENTS];
+
+    while (!end) // Continue until 'end' flag is set
+    {
+        auto now = std::chrono::steady_clock::now();
+        if (now >= next)
+        {
+            broadcast();
+            next = now + period;
+        }
+
+        int timeout = std::chrono::duration_cast<std::chrono::milliseconds>(next - now).count();
+        int count = epoll_wait(epoll_fd, events, MAX_EVENTS, (timeout > 0) ? timeout : 0);
+
+        for (int i = 0; i < count; i++)
+        {
+            int fd = events[i].data.fd;
+
+            if (fd == socket_fd)
             {
-                enable = 1;
+                acceptAll();
+                continue;
             }
 
-            if (setsockopt(socket_fd, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(int)) < 0)
+            if (fd == event_fd)
             {
-                close(socket_fd);
-                continue; // try again
+                uint64_t wakeups{0};
+                if (sizeof(wakeups) == read(event_fd, &wakeups, sizeof(wakeups))) // Reset the counter
+                {
+                    broadcast();
+                    next = std::chrono::steady_clock::now() + period;
+                }
+                continue;
             }
 
-            if (0 != bind(socket_fd, (struct sockaddr *)&server_address, sizeof(server_address)))
+            auto it = clients.find(fd);
+            if (it == clients.end())
             {
-                close(socket_fd);
-                continue; // try again :)
+                continue; // Already dropped during this round
             }
 
-            if (0 != listen(socket_fd, 1))
+            bool alive = !(events[i].events & (EPOLLERR | EPOLLHUP | EPOLLRDHUP));
+
+            if (alive && (events[i].events & EPOLLIN))
             {
-                close(socket_fd);
-                continue; // try again :)
+                uint8_t discard[64];
+                ssize_t n = recv(fd, discard, sizeof(discard), 0); // Clients do not send anything, detect the close
+                alive = (n > 0) || ((n < 0) && ((errno == EAGAIN) || (errno == EWOULDBLOCK)));
             }
-            else
+
+            if (alive && (events[i].events & EPOLLOUT))
             {
-                break;
+                alive = flush(fd, it->second);
             }
 
-        } while (!end);
-
-        sockaddr_in cli{0};
-        socklen_t len = sizeof(cli);
+            if (!alive)
+            {
+                qDebug() << "Connection lost ... dropping client";
+                drop(fd);
+            }
+        }
 
-        int connfd = accept(socket_fd, (sockaddr *)&cli, &len);
-        if (connfd < 0)
+        size_t depth{0};
+        for (const auto &entry : clients)
         {
-            close(socket_fd); // Close the main server socket when we're done
-            continue;         // Go back and eta another connection
+            depth = std::max(depth, entry.second.queue.size()); // The slowest client
         }
+        metrics.set(Metrics::QueueDepth, depth);
 
-        while (!end) // Continue sending buffer until 'end' flag is set
+        if ((depth == 0) && !clients.empty())
         {
-            if (sizeof(Buffer) != write(connfd, Buffer, sizeof(Buffer)))
-            {
-                qDebug() << "Connection lost ... reconnecting..";
-                break;
-            }
-
-            // Delay, to not flood the client
-            std::this_thread::sleep_for(std::chrono::milliseconds(Setting::INTERVAL / 2));
+            deliver(pending); // Every client got every packet queued so far, nobody got it without a client
         }
-        close(connfd);    // Close the client connection
+    }
+
+    while (!clients.empty())
+    {
+        drop(clients.begin()->first);
+    }
+
+    if (epoll_fd != -1)
+    {
+        close(epoll_fd);
+    }
+    if (socket_fd != -1)
+    {
         close(socket_fd); // Close the main server socket when we're done
     }
 }
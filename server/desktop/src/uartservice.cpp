@@ -1,16 +1,16 @@
 #include "uartservice.h"
 #include <QSerialPort>
 #include "setting.h"
+#include "protocol.h"
 #include <QDebug>
-#include <mutex>
 
 /**
  * @brief This function runs the UART service by configuring the serial port settings and writing data to it.
  *
  * @details This function sets the port name, baud rate, parity, data bits, stop bits, and flow control of the serial port.
- * It then enters a loop where it writes data to the serial port until the "end" flag is set. It locks the buffer with a mutex
- * before copying its contents to a temporary array, which is then written to the serial port. If the write operation is successful,
- * it waits for the bytes to be written and sets the status flag to true. If the write operation fails, it sets the status flag to false
+ * It then enters a loop where it writes data to the serial port until the "end" flag is set. It reads the buffer through the seqlock
+ * and wraps it in a Protocol packet with the next sequence number, which is then written to the serial port. If the write operation is successful,
+ * it waits for the bytes to be written, sets the status flag to true and sleeps until a setter changes the frame or the heartbeat expires. If the write operation fails, it sets the status flag to false
  * and breaks out of the loop. If the bytes are not written within the specified interval, it sets the status flag to false and breaks
  * out of the loop. If the serial port fails to open, it prints an error message. If the serial port is open, it closes it before
  * restarting the loop.
@@ -18,10 +18,11 @@
 void UARTService::run()
 {
     QSerialPort serial;
+    uint32_t sequence{0};
 
     // Configure the serial port settings
-    serial.setPortName(Setting::UART_Connection::PORT);
-    serial.setBaudRate(Setting::UART_Connection::BAUDRATE);
+    serial.setPortName(options.device);
+    serial.setBaudRate(options.baudrate);
     serial.setParity(QSerialPort::NoParity);
     serial.setDataBits(QSerialPort::Data8);
     serial.setStopBits(QSerialPort::OneStop);
@@ -33,29 +34,31 @@ void UARTService::run()
         {
             while (!end && serial.isWritable())
             {
-                uint8_t tmparr[sizeof(Buffer)]{0};
+                Protocol::Packet packet;
+                uint64_t generation = pack(sequence++, packet);
 
-                {
-                    std::scoped_lock<std::mutex> locker{mtx};
-                    memcpy(tmparr, Buffer, sizeof(Buffer));
-                }
-
-                if (sizeof(tmparr) == serial.write(reinterpret_cast<char *>(tmparr), sizeof(tmparr)))
+                if (static_cast<qint64>(packet.size()) == serial.write(reinterpret_cast<char *>(packet.data()), packet.size()))
                 {
                     if (serial.waitForBytesWritten(Setting::INTERVAL))
                     {
-                        status = true;
-                        msleep(Setting::INTERVAL / 2);
+                        sent(1, packet.size());
+                        setStatus(true);
+                        deliver(generation);
+
+                        std::unique_lock<std::mutex> locker{mtx};
+                        cv.wait_for(locker, std::chrono::milliseconds(options.heartbeat), [this]
+                                    { return changed || end; });
+                        changed = false;
                     }
                     else
                     {
-                        status = false;
+                        setStatus(false);
                         break;
                     }
                 }
                 else
                 {
-                    status = false;
+                    setStatus(false);
                     qDebug() << "UART read error. Connection may be lost.";
                     break;
                 }
@@ -0,0 +1,96 @@
+/**
+ * @file udpservice.cpp
+ * @brief Implementation of the UDPService class.
+ *
+ * Every frame is wrapped in a Protocol packet and sent as a single datagram to the group given in the options.
+ * The server does not know its clients, a client subscribes by joining the group and checks the sequence numbers itself.
+ */
+#include "udpservice.h"
+#include "setting.h"
+#include "protocol.h"
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <QDebug>
+
+/**
+ * @brief Creates the UDP socket and sets the multicast interface, hop limit and loopback.
+ *
+ * The loopback is enabled so that clients on the same host receive the frames as well.
+ *
+ * @return true The socket is ready to send.
+ * @return false The socket could not be created or configured.
+ */
+bool UDPService::open(void)
+{
+    in_addr interface{0};
+    int ttl{Setting::udp_connection::TTL};
+    unsigned char loop{1};
+
+    destination.sin_family = AF_INET;
+    destination.sin_port = htons(options.udpPort);
+    inet_pton(AF_INET, options.group.toLatin1().constData(), &destination.sin_addr);
+    inet_pton(AF_INET, options.interface.toLatin1().constData(), &interface);
+
+    socket_fd = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    if (socket_fd == -1)
+    {
+        return false;
+    }
+
+    if ((0 != setsockopt(socket_fd, IPPROTO_IP, IP_MULTICAST_IF, &interface, sizeof(interface))) ||
+        (0 != setsockopt(socket_fd, IPPROTO_IP, IP_MULTICAST_TTL, &ttl, sizeof(ttl))) ||
+        (0 != setsockopt(socket_fd, IPPROTO_IP, IP_MULTICAST_LOOP, &loop, sizeof(loop))))
+    {
+        close(socket_fd);
+        socket_fd = -1;
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * @brief This function runs the UDP service.
+ *
+ * It sends the buffer as soon as a setter changes it, and at least every heartbeat so that the clients
+ * can tell a quiet vehicle from a lost server, until the 'end' flag is set.
+ * The status is true as long as the datagrams can be sent, whether anyone listens or not.
+ *
+ * @return void
+ */
+void UDPService::run(void)
+{
+    uint32_t sequence{0};
+
+    while (!end && !open())
+    {
+        qDebug() << "Failed to open the UDP socket";
+        std::this_thread::sleep_for(std::chrono::milliseconds(Setting::INTERVAL)); // try again
+    }
+
+    while (!end)
+    {
+        Protocol::Packet packet;
+        uint64_t generation = pack(sequence++, packet);
+
+        bool written = (static_cast<ssize_t>(packet.size()) == sendto(socket_fd, packet.data(), packet.size(), 0,
+                                                                      (const struct sockaddr *)&destination, sizeof(destination)));
+        sent(written ? 1 : 0, written ? packet.size() : 0);
+        setStatus(written);
+        if (written)
+        {
+            deliver(generation);
+        }
+
+        std::unique_lock<std::mutex> locker{mtx};
+        cv.wait_for(locker, std::chrono::milliseconds(options.heartbeat), [this]
+                    { return changed || end; });
+        changed = false;
+    }
+
+    if (socket_fd != -1)
+    {
+        close(socket_fd);
+    }
+}
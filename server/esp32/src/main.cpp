@@ -2,15 +2,18 @@
  * @file main.cpp
  * @brief This file contains the main function that initializes the CAN module and configures the communication.
  *
- * It also contains the loop function that reads data from the serial port and sends it over the CAN bus.
+ * It also contains the loop function that reads the serial stream, splits it into packets with the Protocol::Parser
+ * and sends their frame over the CAN bus. The parser resynchronizes on the sync marker after a bad byte, like the desktop client.
  *
  */
 #include <Arduino.h>
 #include <CAN.h>
 #include <CAN_config.h>
 #include "setting.h"
+#include "protocol.h"
 
 CAN_device_t CAN_cfg;
+Protocol::Parser parser; // Splits the serial stream into packets, hunts for the sync marker after a lost or corrupted byte
 
 void setup()
 {
@@ -27,12 +30,19 @@ void setup()
 void loop()
 {
     CAN_frame_t frame{0};
+    Protocol::Header header;
+    uint8_t chunk[Protocol::PACKET_SIZE];
 
     frame.FIR.B.DLC = Setting::Signal::BUFSIZE;
     frame.FIR.B.RTR = CAN_no_RTR;
     frame.FIR.B.FF = CAN_frame_std;
 
-    if (Setting::Signal::BUFSIZE == Serial.readBytes(frame.data.u8, Setting::Signal::BUFSIZE))
+    size_t wanted = Serial.available();
+    wanted = (wanted == 0) ? 1 : ((wanted < sizeof(chunk)) ? wanted : sizeof(chunk)); // Wait for one byte at least
+
+    parser.feed(chunk, Serial.readBytes(chunk, wanted));
+
+    while (parser.next(header, frame.data.u8)) // Skips the bytes that do not start a valid packet
     {
         CAN_write_frame(&frame);
     }
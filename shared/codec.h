@@ -0,0 +1,224 @@
+/**
+ * @file codec.h
+ * @brief This file contains the declaration of the Codec namespace which packs and unpacks signals of a frame.
+ *
+ * The frame is loaded once as a little-endian word, every signal is then read or written with a single shift and mask.
+ * The start bit and the length of a signal are the constants declared in setting.h, gathered in the Signal descriptors.
+ */
+#ifndef CODEC_H
+#define CODEC_H
+
+#include <array>
+#include <cstdint>
+#include <type_traits>
+#include "setting.h"
+
+namespace Codec
+{
+    using Word = uint64_t; /**<The type holding a whole frame*/
+
+    constexpr int WORD_LEN{static_cast<int>(sizeof(Word)) * Setting::Signal::BYTE_LEN}; /**<The length of a word in bits*/
+
+    using Frame = std::array<uint8_t, Setting::Signal::BUFSIZE>; /**<The type holding the bytes of a frame*/
+
+    static_assert(Setting::Signal::BUFSIZE <= static_cast<int>(sizeof(Word)), "The frame does not fit in a word");
+
+    /**
+     * @brief Returns a mask with the lowest bits set.
+     * @param length The number of bits to set.
+     * @return The mask.
+     */
+    constexpr Word mask(int length)
+    {
+        return (length >= WORD_LEN) ? ~Word{0} : ((Word{1} << length) - 1);
+    }
+
+    /**
+     * @brief Loads a frame as a little-endian word.
+     * @param frame The frame of Setting::Signal::BUFSIZE bytes.
+     * @return The word.
+     */
+    inline Word load(const uint8_t *frame)
+    {
+        Word word{0};
+        for (int i = 0; i < Setting::Signal::BUFSIZE; i++)
+        {
+            word |= static_cast<Word>(frame[i]) << (i * Setting::Signal::BYTE_LEN);
+        }
+        return word;
+    }
+
+    /**
+     * @brief Stores a word as a little-endian frame.
+     * @param word The word.
+     * @param frame The frame of Setting::Signal::BUFSIZE bytes.
+     */
+    inline void store(Word word, uint8_t *frame)
+    {
+        for (int i = 0; i < Setting::Signal::BUFSIZE; i++)
+        {
+            frame[i] = static_cast<uint8_t>(word >> (i * Setting::Signal::BYTE_LEN));
+        }
+    }
+
+    /**
+     * @brief Extracts an unsigned value from a word.
+     * @param word The word.
+     * @param start The start bit of the value.
+     * @param length The length of the value in bits.
+     * @return The value.
+     */
+    constexpr uint32_t extract(Word word, int start, int length)
+    {
+        return static_cast<uint32_t>((word >> start) & mask(length));
+    }
+
+    /**
+     * @brief Extracts a signed value from a word.
+     *
+     * The field is shifted up to the top of the word and back down with an arithmetic shift, which extends the sign.
+     *
+     * @param word The word.
+     * @param start The start bit of the value.
+     * @param length The length of the value in bits.
+     * @return The value.
+     */
+    constexpr int32_t extractSigned(Word word, int start, int length)
+    {
+        return static_cast<int32_t>(static_cast<int64_t>(word << (WORD_LEN - start - length)) >> (WORD_LEN - length));
+    }
+
+    /**
+     * @brief Inserts a value into a word.
+     * @param word The word.
+     * @param start The start bit of the value.
+     * @param length The length of the value in bits.
+     * @param value The value, only the lowest length bits are used.
+     * @return The word with the value inserted.
+     */
+    constexpr Word insert(Word word, int start, int length, uint32_t value)
+    {
+        return (word & ~(mask(length) << start)) | ((static_cast<Word>(value) & mask(length)) << start);
+    }
+
+    /**
+     * @brief Counts the bits set in a word.
+     * @param word The word.
+     * @return The number of bits set.
+     */
+    constexpr int count(Word word)
+    {
+        int bits{0};
+        for (; word != 0; word &= word - 1)
+        {
+            bits++;
+        }
+        return bits;
+    }
+
+    /**
+     * @brief Describes where a signal lives in the frame and which values it can hold.
+     *
+     * The position and the range are checked at compile time, every access is a fixed shift and mask.
+     *
+     * @tparam T The decoded type of the signal.
+     * @tparam Start The start bit of the signal.
+     * @tparam Length The length of the signal in bits.
+     * @tparam Min The minimum value of the signal.
+     * @tparam Max The maximum value of the signal.
+     */
+    template <typename T, int Start, int Length, int Min, int Max>
+    struct Descriptor
+    {
+        using type = T; /**<The decoded type of the signal*/
+
+        static constexpr int START{Start};                 /**<The start bit of the signal*/
+        static constexpr int LENGTH{Length};               /**<The length of the signal*/
+        static constexpr int MIN{Min};                     /**<The minimum value of the signal*/
+        static constexpr int MAX{Max};                     /**<The maximum value of the signal*/
+        static constexpr Word MASK{mask(Length) << Start}; /**<The bits of the frame used by the signal*/
+
+        static_assert(Start >= 0 && Length > 0 && Length <= 32, "Invalid signal position");
+        static_assert(Start + Length <= Setting::Signal::BUFSIZE * Setting::Signal::BYTE_LEN, "The signal does not fit in the frame");
+        static_assert(Min <= Max, "Invalid signal range");
+        static_assert(std::is_signed_v<T> ? (Min >= -(int64_t{1} << (Length - 1)) && Max < (int64_t{1} << (Length - 1)))
+                                          : (Min >= 0 && static_cast<Word>(Max) <= mask(Length)),
+                      "The signal range does not fit in its length");
+    };
+
+    /**
+     * @brief Groups the descriptors of a frame and checks that no two signals share a bit.
+     * @tparam S The descriptors.
+     */
+    template <typename... S>
+    struct Table
+    {
+        static constexpr Word MASK{(S::MASK | ...)}; /**<The bits of the frame used by the signals*/
+
+        static_assert(count(MASK) == (S::LENGTH + ...), "Signals overlap");
+    };
+
+    /**
+     * @brief Decodes a signal from a word.
+     * @tparam S The descriptor of the signal.
+     * @param word The word.
+     * @return The value of the signal.
+     */
+    template <typename S>
+    constexpr typename S::type get(Word word)
+    {
+        if constexpr (std::is_signed_v<typename S::type>)
+        {
+            return static_cast<typename S::type>(extractSigned(word, S::START, S::LENGTH));
+        }
+        else
+        {
+            return static_cast<typename S::type>(extract(word, S::START, S::LENGTH));
+        }
+    }
+
+    /**
+     * @brief Encodes a signal into a word.
+     * @tparam S The descriptor of the signal.
+     * @param word The word.
+     * @param value The value of the signal.
+     * @return The word with the signal encoded.
+     */
+    template <typename S>
+    constexpr Word set(Word word, typename S::type value)
+    {
+        return insert(word, S::START, S::LENGTH, static_cast<uint32_t>(value));
+    }
+}
+
+/**
+ * @brief The descriptors of the signals carried in a frame, taken from Setting::Signal.
+ */
+namespace Signal
+{
+    using Speed = Codec::Descriptor<uint32_t,
+                                    Setting::Signal::Speed::START, Setting::Signal::Speed::LENGTH,
+                                    Setting::Signal::Speed::MIN, Setting::Signal::Speed::MAX>; /**<The speed signal*/
+
+    using Temperature = Codec::Descriptor<int32_t,
+                                          Setting::Signal::Temperature::START, Setting::Signal::Temperature::LENGTH,
+                                          Setting::Signal::Temperature::MIN, Setting::Signal::Temperature::MAX>; /**<The temperature signal*/
+
+    using BatteryLevel = Codec::Descriptor<uint32_t,
+                                           Setting::Signal::BatteryLevel::START, Setting::Signal::BatteryLevel::LENGTH,
+                                           Setting::Signal::BatteryLevel::MIN, Setting::Signal::BatteryLevel::MAX>; /**<The battery level signal*/
+
+    using LightLeft = Codec::Descriptor<bool,
+                                        Setting::Signal::Light::Left::START, Setting::Signal::Light::Left::LENGTH,
+                                        Setting::Signal::Light::Left::MIN, Setting::Signal::Light::Left::MAX>; /**<The left light signal*/
+
+    using LightRight = Codec::Descriptor<bool,
+                                         Setting::Signal::Light::Right::START, Setting::Signal::Light::Right::LENGTH,
+                                         Setting::Signal::Light::Right::MIN, Setting::Signal::Light::Right::MAX>; /**<The right light signal*/
+
+    using All = Codec::Table<Speed, Temperature, BatteryLevel, LightLeft, LightRight>; /**<All signals of a frame*/
+
+    static_assert(All::MASK != 0, "The frame carries no signal"); /**<Instantiates the overlap check of the table*/
+}
+
+#endif // CODEC_H
@@ -0,0 +1,284 @@
+/**
+ * @file framelog.h
+ * @brief This file contains the declaration of the FrameLog namespace which records frames to a memory-mapped file.
+ *
+ * The file is a Header followed by fixed-size Records, all little-endian as on the hosts the applications run on:
+ *
+ * | Offset      | Size         | Field                                                  |
+ * |-------------|--------------|--------------------------------------------------------|
+ * | 0           | 64           | Header: magic, version, record size, capacity, count   |
+ * | 64 + 24 * n | 24           | Record n: receive time, send time, sequence, frame     |
+ *
+ * The whole file is allocated and mapped when it is opened, so appending a record is a copy into memory and never
+ * blocks on the disk, the kernel writes the pages back in the background. The count in the header is updated after
+ * every record, so a reader can scan a file while it is being written and a crash loses no committed record.
+ * When the file is full, further records are dropped and counted instead of growing the file.
+ */
+#ifndef FRAMELOG_H
+#define FRAMELOG_H
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "setting.h"
+#include "protocol.h"
+
+namespace FrameLog
+{
+    constexpr uint32_t MAGIC{0x474C5053}; /**<Marks a frame log, "SPLG"*/
+    constexpr uint16_t VERSION{1};        /**<The version of the format*/
+
+    /**
+     * @brief The header at the start of the file.
+     */
+    struct Header
+    {
+        uint32_t magic;              /**<MAGIC*/
+        uint16_t version;            /**<VERSION*/
+        uint16_t recordSize;         /**<The size of a record in bytes*/
+        uint64_t capacity;           /**<The number of records the file holds*/
+        std::atomic<uint64_t> count; /**<The number of records written*/
+        uint64_t dropped;            /**<The number of records dropped because the file was full, set when it is closed*/
+        uint8_t reserved[32];        /**<Zero, room for later fields*/
+    };
+
+    /**
+     * @brief A frame as received by the client.
+     */
+    struct Record
+    {
+        uint64_t received;                       /**<The monotonic time the client received the packet in microseconds*/
+        uint64_t sent;                           /**<The timestamp of the packet in microseconds*/
+        uint32_t sequence;                       /**<The sequence number of the packet*/
+        uint8_t frame[Setting::Signal::BUFSIZE]; /**<The frame*/
+        uint8_t reserved[1];                     /**<Zero, pads the record to 24 bytes*/
+    };
+
+    static_assert(sizeof(Header) == 64, "The header must be 64 bytes");
+    static_assert(sizeof(Record) == 24, "The record must be 24 bytes");
+    static_assert(std::atomic<uint64_t>::is_always_lock_free, "The count is read by other processes");
+
+    /**
+     * @brief Returns the size of a file holding a number of records.
+     * @param capacity The number of records.
+     * @return The size in bytes.
+     */
+    inline size_t fileSize(uint64_t capacity)
+    {
+        return sizeof(Header) + capacity * sizeof(Record);
+    }
+
+    /**
+     * @brief The Writer class appends records to a preallocated, memory-mapped file.
+     *
+     * A single thread may append, it is never blocked by the disk.
+     */
+    class Writer
+    {
+        Header *header{nullptr};   /**<The mapped file, nullptr while closed*/
+        Record *records{nullptr};  /**<The records following the header*/
+        uint64_t dropped{0};       /**<The number of records dropped because the file is full*/
+
+    public:
+        Writer() = default;
+        Writer(const Writer &) = delete;
+        Writer &operator=(const Writer &) = delete;
+
+        /**
+         * @brief Creates the file, allocates it on the disk and maps it.
+         * @param path The path of the file, an existing file is replaced.
+         * @param capacity The number of records the file holds.
+         * @return true if the file is ready.
+         */
+        bool open(const char *path, uint64_t capacity)
+        {
+            close();
+
+            int fd = ::open(path, O_CREAT | O_TRUNC | O_RDWR | O_CLOEXEC, 0644);
+            if (fd == -1)
+            {
+                return false;
+            }
+
+            size_t size = fileSize(capacity);
+            if (0 != posix_fallocate(fd, 0, size))
+            {
+                ::close(fd);
+                return false;
+            }
+
+            void *address = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, 0);
+            ::close(fd);
+            if (address == MAP_FAILED)
+            {
+                return false;
+            }
+
+            header = static_cast<Header *>(address);
+            records = reinterpret_cast<Record *>(header + 1);
+            dropped = 0;
+
+            header->version = VERSION;
+            header->recordSize = sizeof(Record);
+            header->capacity = capacity;
+            header->count.store(0, std::memory_order_relaxed);
+            header->dropped = 0;
+            std::atomic_thread_fence(std::memory_order_release);
+            header->magic = MAGIC;
+
+            return true;
+        }
+
+        /**
+         * @brief Appends a record, or drops it if the file is full.
+         * @param packet The header of the packet received.
+         * @param frame The frame of the packet.
+         * @param received The monotonic time the packet was received in microseconds.
+         * @return true if the record was written.
+         */
+        bool append(const Protocol::Header &packet, const uint8_t *frame, uint64_t received)
+        {
+            if (header == nullptr)
+            {
+                return false;
+            }
+
+            uint64_t count = header->count.load(std::memory_order_relaxed);
+            if (count >= header->capacity)
+            {
+                dropped++;
+                return false;
+            }
+
+            Record &record = records[count];
+            record.received = received;
+            record.sent = packet.timestamp;
+            record.sequence = packet.sequence;
+            std::memcpy(record.frame, frame, sizeof(record.frame));
+
+            header->count.store(count + 1, std::memory_order_release);
+            return true;
+        }
+
+        /**
+         * @brief Returns the number of records dropped because the file is full.
+         * @return The number of records.
+         */
+        uint64_t getDropped(void) const { return dropped; }
+
+        /**
+         * @brief Writes the file back and unmaps it.
+         */
+        void close(void)
+        {
+            if (header != nullptr)
+            {
+                size_t size = fileSize(header->capacity);
+                header->dropped = dropped;
+                msync(header, size, MS_ASYNC);
+                munmap(header, size);
+                header = nullptr;
+                records = nullptr;
+            }
+        }
+
+        ~Writer() { close(); }
+    };
+
+    /**
+     * @brief The Reader class maps a frame log to scan its records in place.
+     */
+    class Reader
+    {
+        const Header *header{nullptr};  /**<The mapped file, nullptr while closed*/
+        const Record *records{nullptr}; /**<The records following the header*/
+        size_t size{0};                 /**<The size of the mapping in bytes*/
+
+    public:
+        Reader() = default;
+        Reader(const Reader &) = delete;
+        Reader &operator=(const Reader &) = delete;
+
+        /**
+         * @brief Maps a frame log and checks its header.
+         * @param path The path of the file.
+         * @return true if the file is a frame log of this version.
+         */
+        bool open(const char *path)
+        {
+            close();
+
+            int fd = ::open(path, O_RDONLY | O_CLOEXEC);
+            if (fd == -1)
+            {
+                return false;
+            }
+
+            struct stat info{};
+            if ((0 != fstat(fd, &info)) || (info.st_size < static_cast<off_t>(sizeof(Header))))
+            {
+                ::close(fd);
+                return false;
+            }
+
+            void *address = mmap(nullptr, info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+            ::close(fd);
+            if (address == MAP_FAILED)
+            {
+                return false;
+            }
+
+            header = static_cast<const Header *>(address);
+            records = reinterpret_cast<const Record *>(header + 1);
+            size = info.st_size;
+
+            if ((header->magic != MAGIC) || (header->version != VERSION) || (header->recordSize != sizeof(Record)) ||
+                (fileSize(header->capacity) > size))
+            {
+                close();
+                return false;
+            }
+
+            return true;
+        }
+
+        /**
+         * @brief Returns the number of records written so far, the file may still be growing.
+         * @return The number of records.
+         */
+        uint64_t count(void) const
+        {
+            uint64_t count = header->count.load(std::memory_order_acquire);
+            return (count < header->capacity) ? count : header->capacity;
+        }
+
+        /**
+         * @brief Returns a record.
+         * @param index The index of the record, less than count().
+         * @return The record.
+         */
+        const Record &at(uint64_t index) const { return records[index]; }
+
+        /**
+         * @brief Unmaps the file.
+         */
+        void close(void)
+        {
+            if (header != nullptr)
+            {
+                munmap(const_cast<Header *>(header), size);
+                header = nullptr;
+                records = nullptr;
+                size = 0;
+            }
+        }
+
+        ~Reader() { close(); }
+    };
+}
+
+#endif // FRAMELOG_H
@@ -0,0 +1,296 @@
+/**
+ * @file metrics.h
+ * @brief This file contains the declaration of the Metrics namespace which counts the health of a transport.
+ *
+ * Every COMService owns a Registry of counters and gauges, written by its I/O thread with relaxed atomics and read
+ * from any thread without a lock. The Exporter serves them in the Prometheus text format over HTTP on the loopback,
+ * so the link can be watched while the applications run, e.g.
+ * @code
+ * ./client --transport tcp --metrics 9100
+ * curl -s http://127.0.0.1:9100/metrics
+ * speedometer_frames_received_total{role="client",transport="tcp"} 1204
+ * @endcode
+ * The header is only used by the desktop applications, the ESP32 firmware does not include it.
+ */
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <functional>
+#include <poll.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/eventfd.h>
+#include "protocol.h"
+
+namespace Metrics
+{
+    constexpr char PREFIX[]{"speedometer_"}; /**<The prefix of every metric name*/
+    constexpr int REQUEST_TIMEOUT{100};      /**<The time the exporter waits for the request of a scraper in milliseconds*/
+
+    /**
+     * @brief The metrics of a transport, the index of each one in the registry.
+     */
+    enum Id
+    {
+        FramesReceived,   /**<Valid packets received*/
+        FramesSent,       /**<Packets written to the link*/
+        BytesReceived,    /**<Bytes read from the link*/
+        BytesSent,        /**<Bytes written to the link*/
+        ShortReads,       /**<Reads that ended within a packet, or datagrams shorter than a packet*/
+        Reconnects,       /**<Times the link came up again after it was lost*/
+        CrcErrors,        /**<Packets failing the CRC*/
+        InvalidPackets,   /**<Packets with a wrong sync marker, version or length*/
+        PacketsLost,      /**<Packets missing in the sequence*/
+        PacketsReordered, /**<Packets received late or twice*/
+        QueueDepth,       /**<Packets waiting, read in one batch by the client or queued for the slowest client by the server*/
+        LastFrame,        /**<The monotonic time of the last packet received or sent in microseconds, 0 before the first one*/
+        COUNT             /**<The number of metrics*/
+    };
+
+    /**
+     * @brief How a metric is exported.
+     */
+    struct Descriptor
+    {
+        const char *name; /**<The name after the prefix*/
+        const char *type; /**<The Prometheus type, counter or gauge*/
+        const char *help; /**<The description*/
+    };
+
+    /**
+     * @brief The descriptors of the metrics, in the order of their Id.
+     */
+    constexpr Descriptor DESCRIPTORS[COUNT]{
+        {"frames_received_total", "counter", "Valid packets received."},
+        {"frames_sent_total", "counter", "Packets written to the link."},
+        {"bytes_received_total", "counter", "Bytes read from the link."},
+        {"bytes_sent_total", "counter", "Bytes written to the link."},
+        {"short_reads_total", "counter", "Reads that ended within a packet, or datagrams shorter than a packet."},
+        {"reconnects_total", "counter", "Times the link came up again after it was lost."},
+        {"crc_errors_total", "counter", "Packets failing the CRC."},
+        {"invalid_packets_total", "counter", "Packets with a wrong sync marker, version or length."},
+        {"packets_lost_total", "counter", "Packets missing in the sequence."},
+        {"packets_reordered_total", "counter", "Packets received late or twice, they are discarded."},
+        {"queue_depth", "gauge", "Packets read in the last batch by the client, or queued for the slowest client by the server."},
+        {"last_frame_age_seconds", "gauge", "Time since the last packet was received or sent, NaN before the first one."},
+    };
+
+    /**
+     * @brief The Registry class holds the metrics of a transport, lock-free for the writers and the readers.
+     *
+     * The metrics are independent of each other, so relaxed atomics suffice. A counter may be incremented from
+     * several threads, a gauge must be set from one thread only.
+     */
+    class Registry
+    {
+        std::array<std::atomic<uint64_t>, COUNT> values{}; /**<The value of every metric*/
+
+    public:
+        /**
+         * @brief Increments a counter.
+         * @param id The counter.
+         * @param count The increment.
+         */
+        void add(Id id, uint64_t count = 1) { values[id].fetch_add(count, std::memory_order_relaxed); }
+
+        /**
+         * @brief Sets a gauge.
+         * @param id The gauge.
+         * @param value The value.
+         */
+        void set(Id id, uint64_t value) { values[id].store(value, std::memory_order_relaxed); }
+
+        /**
+         * @brief Returns the value of a metric.
+         * @param id The metric.
+         * @return The value, LastFrame is a time and not an age.
+         */
+        uint64_t get(Id id) const { return values[id].load(std::memory_order_relaxed); }
+
+        /**
+         * @brief Formats every metric in the Prometheus text exposition format.
+         * @param labels The labels of every sample without the braces, e.g. role="client",transport="tcp".
+         * @return The text, one HELP, TYPE and sample line per metric.
+         */
+        std::string format(const std::string &labels) const
+        {
+            std::string text;
+            char line[256];
+
+            for (int id = 0; id < COUNT; id++)
+            {
+                const Descriptor &metric = DESCRIPTORS[id];
+                uint64_t value = get(static_cast<Id>(id));
+
+                std::snprintf(line, sizeof(line), "# HELP %s%s %s\n# TYPE %s%s %s\n", PREFIX, metric.name, metric.help,
+                              PREFIX, metric.name, metric.type);
+                text += line;
+
+                if ((id == LastFrame) && (value == 0))
+                {
+                    std::snprintf(line, sizeof(line), "%s%s{%s} NaN\n", PREFIX, metric.name, labels.c_str());
+                }
+                else if (id == LastFrame)
+                {
+                    uint64_t now = Protocol::now();
+                    double age = ((now > value) ? (now - value) : 0) / 1e6;
+                    std::snprintf(line, sizeof(line), "%s%s{%s} %.6f\n", PREFIX, metric.name, labels.c_str(), age);
+                }
+                else
+                {
+                    std::snprintf(line, sizeof(line), "%s%s{%s} %llu\n", PREFIX, metric.name, labels.c_str(),
+                                  static_cast<unsigned long long>(value));
+                }
+                text += line;
+            }
+
+            return text;
+        }
+    };
+
+    /**
+     * @brief The Exporter class answers every HTTP request on a loopback port with the metrics, as Prometheus scrapes them.
+     *
+     * The requests are served one at a time on a thread of their own, the path is not checked. The I/O threads of the
+     * transports are never involved, a scrape only reads the atomics of the registry.
+     */
+    class Exporter
+    {
+    public:
+        using Producer = std::function<std::string(void)>; /**<Returns the text of the metrics, called for every request*/
+
+    private:
+        Producer producer; /**<The text of the metrics, set before the thread starts*/
+        int socket_fd{-1}; /**<The listening socket*/
+        int event_fd{-1};  /**<Written by close() to wake up the thread*/
+        std::thread thrd;  /**<Serves the requests, started by open()*/
+
+        /**
+         * @brief Answers one connection with the metrics and closes it.
+         * @param fd The socket of the connection.
+         */
+        void serve(int fd)
+        {
+            pollfd request{fd, POLLIN, 0};
+            char discard[1024];
+            if (poll(&request, 1, REQUEST_TIMEOUT) > 0)
+            {
+                [[maybe_unused]] ssize_t n = recv(fd, discard, sizeof(discard), MSG_DONTWAIT); // The request is not parsed
+            }
+
+            std::string body = producer();
+            std::string response = "HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\nContent-Length: " +
+                                   std::to_string(body.size()) + "\r\nConnection: close\r\n\r\n" + body;
+
+            for (size_t sent = 0; sent < response.size();)
+            {
+                ssize_t n = send(fd, response.data() + sent, response.size() - sent, MSG_NOSIGNAL);
+                if (n <= 0)
+                {
+                    break;
+                }
+                sent += n;
+            }
+            ::close(fd);
+        }
+
+        /**
+         * @brief Accepts and serves connections until close() is called.
+         */
+        void run(void)
+        {
+            while (true)
+            {
+                pollfd fds[2]{{event_fd, POLLIN, 0}, {socket_fd, POLLIN, 0}};
+                if ((poll(fds, 2, -1) < 0) && (errno != EINTR))
+                {
+                    return;
+                }
+                if ((fds[0].revents != 0) || (fds[1].revents & (POLLERR | POLLHUP | POLLNVAL)))
+                {
+                    return; // Stopped
+                }
+
+                int fd = accept4(socket_fd, nullptr, nullptr, SOCK_CLOEXEC);
+                if (fd != -1)
+                {
+                    serve(fd);
+                }
+            }
+        }
+
+    public:
+        /**
+         * @brief Listens on a loopback port and starts serving the metrics.
+         * @param port The TCP port on 127.0.0.1.
+         * @param callback Returns the text of the metrics, called from the thread of the exporter.
+         * @return true if the port is listening, false if it is taken or the socket failed.
+         */
+        bool open(uint16_t port, Producer callback)
+        {
+            close();
+
+            sockaddr_in address{};
+            address.sin_family = AF_INET;
+            address.sin_port = htons(port);
+            address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+            int enable{1};
+            socket_fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+            event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+            if ((socket_fd == -1) || (event_fd == -1) ||
+                (0 != setsockopt(socket_fd, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable))) ||
+                (0 != bind(socket_fd, reinterpret_cast<sockaddr *>(&address), sizeof(address))) ||
+                (0 != listen(socket_fd, SOMAXCONN)))
+            {
+                close();
+                return false;
+            }
+
+            producer = std::move(callback);
+            thrd = std::thread{&Exporter::run, this};
+
+            return true;
+        }
+
+        /**
+         * @brief Stops serving and closes the port.
+         */
+        void close(void)
+        {
+            if (thrd.joinable())
+            {
+                uint64_t one{1};
+                if (sizeof(one) != write(event_fd, &one, sizeof(one)))
+                {
+                    shutdown(socket_fd, SHUT_RDWR); // Wakes up the poll as well
+                }
+                thrd.join();
+            }
+            if (socket_fd != -1)
+            {
+                ::close(socket_fd);
+                socket_fd = -1;
+            }
+            if (event_fd != -1)
+            {
+                ::close(event_fd);
+                event_fd = -1;
+            }
+        }
+
+        ~Exporter() { close(); }
+    };
+}
+
+#endif // METRICS_H
@@ -0,0 +1,358 @@
+/**
+ * @file options.h
+ * @brief This file contains the declaration of the Options struct which selects and configures the transport at startup.
+ *
+ * Every option defaults to the constant of the shared setting.h file. It can be overridden by a key of an INI
+ * file given with --config, which is in turn overridden by the command-line option of the same name, e.g.
+ * @code
+ * ./client --transport uart --device /dev/ttyUSB1 --baudrate 57600
+ * ./server --transport udp --group 239.255.0.45 --heartbeat 250
+ * ./client --transport shm --record frames.log
+ * ./server --transport tcp --replay frames.log --speed 10
+ * ./client --render 1000 --snapshot frame.png
+ * ./client --transport shm --latency latency.jsonl
+ * ./server --transport tcp --metrics 9100
+ * ./client --transport uart --stale-speed 300
+ * @endcode
+ * Each application only accepts its own options, e.g. the server rejects --render and the client rejects --replay,
+ * whether they are given on the command line or in the INI file.
+ * The header is only used by the desktop applications, the ESP32 firmware does not include it.
+ */
+#ifndef OPTIONS_H
+#define OPTIONS_H
+
+#include <cstring>
+#include <arpa/inet.h>
+#include <QString>
+#include <QSettings>
+#include <QStringList>
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include "setting.h"
+
+/**
+ * @brief The Options struct holds the transport chosen at startup and its parameters.
+ */
+struct Options
+{
+    /**
+     * @brief The transports compiled into the applications.
+     */
+    enum class Transport
+    {
+        TCP,  /**<A connection per client to the server*/
+        UDP,  /**<Datagrams to a multicast group*/
+        UART, /**<A serial port bridged to the CAN bus by the ESP32*/
+        SHM   /**<A shared memory ring, server and client on the same host*/
+    };
+
+    /**
+     * @brief The application parsing the options.
+     */
+    enum class Role
+    {
+        Client, /**<The speedometer, it receives the frames*/
+        Server  /**<The vehicle, it sends the frames*/
+    };
+
+    Transport transport{Transport::TCP};                       /**<The transport used*/
+    QString host{Setting::tcp_connection::tcp_ip::IP};         /**<The IP address of the TCP server*/
+    int tcpPort{Setting::tcp_connection::tcp_port::PORT};      /**<The port of the TCP connection*/
+    QString group{Setting::udp_connection::GROUP};             /**<The multicast group or unicast address of the UDP frames*/
+    QString interface{Setting::udp_connection::INTERFACE};     /**<The address of the interface used for multicast*/
+    int udpPort{Setting::udp_connection::PORT};                /**<The port of the UDP frames*/
+    QString device{Setting::UART_Connection::PORT};            /**<The serial port of the UART connection*/
+    int baudrate{Setting::UART_Connection::BAUDRATE};          /**<The baud rate of the UART connection*/
+    QString shm{Setting::shm_connection::NAME};                /**<The name of the shared memory object*/
+    int heartbeat{Setting::HEARTBEAT};                         /**<The maximum time between two frames in milliseconds*/
+    int maxFps{Setting::Client::MAX_FPS};                      /**<The maximum number of canvas refreshes per second of the client*/
+    int staleSpeed{Setting::Signal::Speed::STALE};             /**<The time without any frame after which the speed is stale in milliseconds*/
+    int staleTemperature{Setting::Signal::Temperature::STALE}; /**<The time without any frame after which the temperature is stale in milliseconds*/
+    int staleBattery{Setting::Signal::BatteryLevel::STALE};    /**<The time without any frame after which the battery level is stale in milliseconds*/
+    int staleLights{Setting::Signal::Light::Left::STALE};      /**<The time without any frame after which the lights are stale in milliseconds*/
+    QString record;                                            /**<The file the client records the frames to, empty to not record*/
+    int records{Setting::Client::RECORD_CAPACITY};             /**<The number of frames the recording holds*/
+    QString replay;                                            /**<The recording the server streams instead of its sliders, empty to show the window*/
+    double speed{1.0};                                         /**<The speed of the replay, 0 to stream as fast as possible*/
+    int frames{0};                                             /**<The number of frames the client renders offscreen, 0 to show the window*/
+    QString snapshot;                                          /**<The image the last offscreen frame is saved to, empty to not save it*/
+    QString latency;                                           /**<The file the client dumps the latency histograms to at exit, empty to not dump them*/
+    int metrics{0};                                            /**<The port on the loopback the metrics are served on, 0 to not serve them*/
+
+    /**
+     * @brief Returns the time without any frame after which the connection is considered lost.
+     * @return The timeout in milliseconds.
+     */
+    int timeout(void) const { return heartbeat * (Setting::TIMEOUT / Setting::HEARTBEAT); }
+
+    /**
+     * @brief Returns the name of the transport as given on the command line.
+     * @return The name in lower case, e.g. "tcp".
+     */
+    const char *transportName(void) const
+    {
+        switch (transport)
+        {
+        case Transport::UDP:
+            return "udp";
+        case Transport::UART:
+            return "uart";
+        case Transport::SHM:
+            return "shm";
+        case Transport::TCP:
+        default:
+            return "tcp";
+        }
+    }
+
+    /**
+     * @brief Reads an option before the application is created, from the command line or else from the config file.
+     * @param argc The number of arguments.
+     * @param argv The arguments.
+     * @param name The name of the option, without the dashes.
+     * @return The value of the option, with the same precedence as parse, empty if it is not given.
+     */
+    static QString peek(int argc, char *argv[], const char *name)
+    {
+        auto argument = [argc, argv](const char *option) -> const char *
+        {
+            const size_t length = std::strlen(option);
+            for (int i = 1; i < argc; i++)
+            {
+                if ((0 == std::strncmp(argv[i], "--", 2)) && (0 == std::strncmp(argv[i] + 2, option, length)))
+                {
+                    const char *rest = argv[i] + 2 + length;
+                    if (*rest == '=')
+                    {
+                        return rest + 1;
+                    }
+                    if ((*rest == '\0') && (i + 1 < argc))
+                    {
+                        return argv[i + 1];
+                    }
+                }
+            }
+            return nullptr;
+        };
+
+        if (const char *value = argument(name))
+        {
+            return QString::fromLocal8Bit(value);
+        }
+
+        const char *file = argument("config");
+        return (file == nullptr) ? QString() : QSettings{QString::fromLocal8Bit(file), QSettings::IniFormat}.value(name).toString();
+    }
+
+    /**
+     * @brief Reads the options from the command line of the application and the optional config file.
+     * @param app The application, its arguments are parsed.
+     * @param role The application, the options of the other one are rejected.
+     * @param error The reason when the options are invalid.
+     * @return true if the options are valid.
+     */
+    bool parse(const QCoreApplication &app, Role role, QString &error)
+    {
+        const QList<QCommandLineOption> client{
+            {"max-fps", "Maximum number of canvas refreshes per second.", "fps", QString::number(maxFps)},
+            {"stale-speed", "Time without any frame after which the speed is greyed out, scales with the heartbeat by default.", "ms"},
+            {"stale-temperature", "Time without any frame after which the temperature is greyed out.", "ms"},
+            {"stale-battery", "Time without any frame after which the battery level is greyed out.", "ms"},
+            {"stale-lights", "Time without any frame after which the lights are greyed out.", "ms"},
+            {"record", "File the frames received are recorded to.", "file"},
+            {"records", "Number of frames the recording holds.", "count", QString::number(records)},
+            {"render", "Number of frames rendered offscreen without a window.", "frames", "0"},
+            {"snapshot", "Image the last offscreen frame is saved to, e.g. a PNG file.", "file"},
+            {"latency", "File the latency histograms are dumped to at exit, as JSON lines.", "file"},
+        };
+        const QList<QCommandLineOption> server{
+            {"replay", "Recording streamed without a window.", "file"},
+            {"speed", "Speed of the replay, 2 for twice as fast, 0 for as fast as possible.", "factor", "1"},
+        };
+        const bool isClient = (role == Role::Client);
+
+        QCommandLineParser parser;
+        parser.setApplicationDescription(isClient ? "Speedometer client, the transport is chosen at startup."
+                                                  : "Speedometer server, the transport is chosen at startup.");
+        parser.addHelpOption();
+        parser.addOptions({
+            {"config", "INI file providing any of the options below.", "file"},
+            {"transport", "tcp, udp, uart or shm.", "name", "tcp"},
+            {"host", "IP address of the TCP server.", "address", host},
+            {"port", "Port of the TCP connection or of the UDP frames.", "port"},
+            {"group", "Multicast group or unicast address of the UDP frames.", "address", group},
+            {"interface", "Address of the interface used for multicast.", "address", interface},
+            {"device", "Serial port of the UART connection.", "device", device},
+            {"baudrate", "Baud rate of the UART connection.", "rate", QString::number(baudrate)},
+            {"shm", "Name of the shared memory object.", "name", shm},
+            {"heartbeat", "Maximum time between two frames in milliseconds.", "ms", QString::number(heartbeat)},
+            {"metrics", "Port on 127.0.0.1 serving the metrics of the transport in the Prometheus text format, 0 for none.", "port", "0"},
+        });
+        parser.addOptions(isClient ? client : server);
+        parser.process(app); /**<Exits with an error on an option of the other application*/
+
+        QSettings config{parser.value("config"), QSettings::IniFormat};
+        for (const QCommandLineOption &option : isClient ? server : client)
+        {
+            if (config.contains(option.names().first()))
+            {
+                error = (isClient ? "Option of the server only: " : "Option of the client only: ") + option.names().first();
+                return false;
+            }
+        }
+
+        auto value = [&](const QString &name)
+        {
+            return (parser.isSet(name) || !config.contains(name)) ? parser.value(name) : config.value(name).toString();
+        };
+
+        QString name = value("transport").toLower();
+        if (name == "tcp")
+        {
+            transport = Transport::TCP;
+        }
+        else if (name == "udp")
+        {
+            transport = Transport::UDP;
+        }
+        else if (name == "uart")
+        {
+            transport = Transport::UART;
+        }
+        else if (name == "shm")
+        {
+            transport = Transport::SHM;
+        }
+        else
+        {
+            error = "Unknown transport: " + name;
+            return false;
+        }
+
+        bool valid{true};
+        QString port = value("port");
+        if (!port.isEmpty())
+        {
+            ((transport == Transport::UDP) ? udpPort : tcpPort) = port.toInt(&valid);
+            if (!valid || (port.toInt() < 1) || (port.toInt() > 65535))
+            {
+                error = "Invalid port: " + port;
+                return false;
+            }
+        }
+
+        /**<A text that is not an IPv4 address would silently become 0.0.0.0 in the transports*/
+        auto address = [&](const QString &name, QString &text, in_addr &parsed)
+        {
+            text = value(name);
+            if (1 != inet_pton(AF_INET, text.toLatin1().constData(), &parsed))
+            {
+                error = "Invalid " + name + " address: " + text;
+                return false;
+            }
+            return true;
+        };
+
+        in_addr parsed{};
+        if (!address("host", host, parsed) || !address("interface", interface, parsed) || !address("group", group, parsed))
+        {
+            return false;
+        }
+
+        const uint32_t destination = ntohl(parsed.s_addr); /**<The group, the frames go to a multicast group or a single host*/
+        if (!IN_MULTICAST(destination) && ((destination == INADDR_ANY) || (destination == INADDR_BROADCAST) || IN_EXPERIMENTAL(destination)))
+        {
+            error = "Invalid group, neither a multicast group nor a unicast address: " + group;
+            return false;
+        }
+
+        device = value("device");
+        shm = value("shm");
+
+        baudrate = value("baudrate").toInt(&valid);
+        if (!valid || (baudrate <= 0))
+        {
+            error = "Invalid baud rate: " + value("baudrate");
+            return false;
+        }
+
+        heartbeat = value("heartbeat").toInt(&valid);
+        if (!valid || (heartbeat <= 0))
+        {
+            error = "Invalid heartbeat: " + value("heartbeat");
+            return false;
+        }
+
+        metrics = value("metrics").toInt(&valid);
+        if (!valid || (metrics < 0) || (metrics > 65535))
+        {
+            error = "Invalid metrics port: " + value("metrics");
+            return false;
+        }
+
+        if (isClient)
+        {
+            record = value("record");
+            snapshot = value("snapshot");
+            latency = value("latency");
+
+            maxFps = value("max-fps").toInt(&valid);
+            if (!valid || (maxFps <= 0) || (maxFps > 1000))
+            {
+                error = "Invalid maximum frame rate: " + value("max-fps");
+                return false;
+            }
+
+            /**<A threshold not given scales with the heartbeat, like the timeout*/
+            auto stale = [&](const QString &name, int fallback, int &threshold)
+            {
+                bool ok{true};
+                QString text = value(name);
+                threshold = text.isEmpty() ? fallback * heartbeat / Setting::HEARTBEAT : text.toInt(&ok);
+                if (!ok || (threshold <= 0))
+                {
+                    error = "Invalid " + name + ": " + text;
+                    return false;
+                }
+                return true;
+            };
+
+            if (!stale("stale-speed", Setting::Signal::Speed::STALE, staleSpeed) ||
+                !stale("stale-temperature", Setting::Signal::Temperature::STALE, staleTemperature) ||
+                !stale("stale-battery", Setting::Signal::BatteryLevel::STALE, staleBattery) ||
+                !stale("stale-lights", Setting::Signal::Light::Left::STALE, staleLights))
+            {
+                return false;
+            }
+
+            records = value("records").toInt(&valid);
+            if (!valid || (records <= 0))
+            {
+                error = "Invalid number of records: " + value("records");
+                return false;
+            }
+
+            frames = value("render").toInt(&valid);
+            if (!valid || (frames < 0))
+            {
+                error = "Invalid number of frames: " + value("render");
+                return false;
+            }
+        }
+        else
+        {
+            replay = value("replay");
+
+            speed = value("speed").toDouble(&valid);
+            if (!valid || (speed < 0))
+            {
+                error = "Invalid speed: " + value("speed");
+                return false;
+            }
+        }
+
+        return true;
+    }
+};
+
+#endif // OPTIONS_H
@@ -0,0 +1,346 @@
+/**
+ * @file protocol.h
+ * @brief This file contains the declaration of the Protocol namespace which frames the signals sent over the links.
+ *
+ * A packet is laid out as follows, all fields are little-endian:
+ *
+ * | Offset | Size   | Field                                              |
+ * |--------|--------|----------------------------------------------------|
+ * | 0      | 2      | Sync marker 0xA5 0x5A                              |
+ * | 2      | 1      | Version of the protocol                            |
+ * | 3      | 1      | Length of the payload in bytes                     |
+ * | 4      | 4      | Sequence number, incremented for every packet      |
+ * | 8      | 8      | Monotonic timestamp in microseconds                |
+ * | 16     | 4      | Age of the frame in microseconds                   |
+ * | 20     | length | Payload, the frame of Setting::Signal::BUFSIZE     |
+ * | 20 + n | 2      | CRC-16/CCITT-FALSE from the version to the payload |
+ *
+ * The timestamps are taken from the monotonic clock of the sender, so the latency is only meaningful
+ * when both ends share that clock, i.e. run on the same host. The age is the time between the last change
+ * of the frame and the packet, measured by the sender alone, so it is valid across hosts.
+ * The header only needs C++11 so that the ESP32 firmware can use it as well.
+ */
+#ifndef PROTOCOL_H
+#define PROTOCOL_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include "setting.h"
+
+#ifndef ARDUINO
+#include <chrono>
+#endif
+
+namespace Protocol
+{
+    constexpr uint8_t SYNC[2]{0xA5, 0x5A}; /**<The marker at the start of every packet*/
+    constexpr uint8_t VERSION{2};          /**<The version of the protocol, 2 added the age*/
+
+    constexpr int HEADER_SIZE{20};                                       /**<The size of the header in bytes*/
+    constexpr int CRC_SIZE{2};                                           /**<The size of the CRC in bytes*/
+    constexpr int PAYLOAD_SIZE{Setting::Signal::BUFSIZE};                /**<The size of the payload in bytes*/
+    constexpr int PACKET_SIZE{HEADER_SIZE + PAYLOAD_SIZE + CRC_SIZE};    /**<The size of a whole packet in bytes*/
+
+    using Packet = std::array<uint8_t, PACKET_SIZE>; /**<The type holding the bytes of a packet*/
+
+    /**
+     * @brief The result of decoding a packet.
+     */
+    enum class Result
+    {
+        Ok,         /**<The packet is valid*/
+        Incomplete, /**<Not enough bytes for a whole packet*/
+        BadSync,    /**<The packet does not start with the sync marker*/
+        BadVersion, /**<The packet has another version of the protocol*/
+        BadLength,  /**<The payload does not have the size of a frame*/
+        BadCrc      /**<The packet is corrupted*/
+    };
+
+    /**
+     * @brief The header of a packet.
+     */
+    struct Header
+    {
+        uint8_t version{0};     /**<The version of the protocol*/
+        uint8_t length{0};      /**<The length of the payload in bytes*/
+        uint32_t sequence{0};   /**<The sequence number of the packet*/
+        uint64_t timestamp{0};  /**<The monotonic timestamp in microseconds when the packet was sent*/
+        uint32_t age{0};        /**<The time between the last change of the frame and the packet in microseconds*/
+    };
+
+#ifndef ARDUINO
+    /**
+     * @brief Returns the monotonic time used for the timestamps.
+     * @return The time in microseconds.
+     */
+    inline uint64_t now(void)
+    {
+        return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+#endif
+
+    /**
+     * @brief Computes the CRC-16/CCITT-FALSE of a block of bytes.
+     * @param data The bytes.
+     * @param size The number of bytes.
+     * @return The CRC.
+     */
+    inline uint16_t crc16(const uint8_t *data, size_t size)
+    {
+        uint16_t crc{0xFFFF};
+        for (size_t i = 0; i < size; i++)
+        {
+            crc ^= static_cast<uint16_t>(data[i]) << 8;
+            for (int bit = 0; bit < 8; bit++)
+            {
+                crc = (crc & 0x8000) ? static_cast<uint16_t>((crc << 1) ^ 0x1021) : static_cast<uint16_t>(crc << 1);
+            }
+        }
+        return crc;
+    }
+
+    /**
+     * @brief Writes an unsigned integer in little-endian order.
+     * @param value The value.
+     * @param size The number of bytes to write.
+     * @param data The destination.
+     */
+    inline void put(uint64_t value, int size, uint8_t *data)
+    {
+        for (int i = 0; i < size; i++)
+        {
+            data[i] = static_cast<uint8_t>(value >> (i * Setting::Signal::BYTE_LEN));
+        }
+    }
+
+    /**
+     * @brief Reads an unsigned integer in little-endian order.
+     * @param data The source.
+     * @param size The number of bytes to read.
+     * @return The value.
+     */
+    inline uint64_t take(const uint8_t *data, int size)
+    {
+        uint64_t value{0};
+        for (int i = 0; i < size; i++)
+        {
+            value |= static_cast<uint64_t>(data[i]) << (i * Setting::Signal::BYTE_LEN);
+        }
+        return value;
+    }
+
+    /**
+     * @brief Returns the age of a frame, saturated to the range of the field.
+     * @param changed The monotonic time the frame last changed in microseconds.
+     * @param timestamp The monotonic time the packet is sent in microseconds.
+     * @return The age in microseconds.
+     */
+    inline uint32_t age(uint64_t changed, uint64_t timestamp)
+    {
+        return (timestamp <= changed) ? 0 : ((timestamp - changed >= UINT32_MAX) ? UINT32_MAX : static_cast<uint32_t>(timestamp - changed));
+    }
+
+    /**
+     * @brief Builds a packet around a frame.
+     * @param payload The frame of PAYLOAD_SIZE bytes.
+     * @param sequence The sequence number of the packet.
+     * @param timestamp The monotonic timestamp in microseconds.
+     * @param age The time since the frame last changed in microseconds.
+     * @param packet The packet.
+     */
+    inline void encode(const uint8_t *payload, uint32_t sequence, uint64_t timestamp, uint32_t age, Packet &packet)
+    {
+        packet[0] = SYNC[0];
+        packet[1] = SYNC[1];
+        packet[2] = VERSION;
+        packet[3] = PAYLOAD_SIZE;
+        put(sequence, 4, &packet[4]);
+        put(timestamp, 8, &packet[8]);
+        put(age, 4, &packet[16]);
+
+        for (int i = 0; i < PAYLOAD_SIZE; i++)
+        {
+            packet[HEADER_SIZE + i] = payload[i];
+        }
+
+        put(crc16(&packet[2], HEADER_SIZE - 2 + PAYLOAD_SIZE), CRC_SIZE, &packet[HEADER_SIZE + PAYLOAD_SIZE]);
+    }
+
+    /**
+     * @brief Validates a packet and extracts its header and frame.
+     * @param data The bytes, starting at the sync marker.
+     * @param size The number of bytes available.
+     * @param header The header of the packet.
+     * @param payload The frame of PAYLOAD_SIZE bytes, only written if the packet is valid.
+     * @return The result of the validation.
+     */
+    inline Result decode(const uint8_t *data, size_t size, Header &header, uint8_t *payload)
+    {
+        if (size < 4)
+        {
+            return Result::Incomplete;
+        }
+        if ((data[0] != SYNC[0]) || (data[1] != SYNC[1]))
+        {
+            return Result::BadSync;
+        }
+        if (data[2] != VERSION)
+        {
+            return Result::BadVersion;
+        }
+        if (data[3] != PAYLOAD_SIZE)
+        {
+            return Result::BadLength;
+        }
+        if (size < static_cast<size_t>(PACKET_SIZE))
+        {
+            return Result::Incomplete;
+        }
+        if (crc16(&data[2], HEADER_SIZE - 2 + PAYLOAD_SIZE) != take(&data[HEADER_SIZE + PAYLOAD_SIZE], CRC_SIZE))
+        {
+            return Result::BadCrc;
+        }
+
+        header.version = data[2];
+        header.length = data[3];
+        header.sequence = static_cast<uint32_t>(take(&data[4], 4));
+        header.timestamp = take(&data[8], 8);
+        header.age = static_cast<uint32_t>(take(&data[16], 4));
+
+        for (int i = 0; i < PAYLOAD_SIZE; i++)
+        {
+            payload[i] = data[HEADER_SIZE + i];
+        }
+
+        return Result::Ok;
+    }
+
+    /**
+     * @brief The Parser class splits a byte stream into packets.
+     *
+     * The bytes are accumulated in a ring buffer as they arrive, in chunks of any size.
+     * Bytes that do not start a valid packet are skipped one at a time until the next sync marker,
+     * so the parser recovers from a lost or corrupted byte by itself.
+     */
+    class Parser
+    {
+    public:
+        static constexpr size_t CAPACITY{8 * PACKET_SIZE}; /**<The number of bytes the ring buffer holds*/
+
+    private:
+        std::array<uint8_t, CAPACITY> ring{}; /**<The bytes received and not parsed yet*/
+        size_t head{0};                       /**<The index of the oldest byte*/
+        size_t size{0};                       /**<The number of bytes in the ring buffer*/
+        uint32_t skipped{0};                  /**<The number of bytes skipped to resynchronize*/
+        uint32_t corrupted{0};                /**<The number of packets failing the CRC*/
+
+        /**
+         * @brief Discards the oldest bytes.
+         * @param count The number of bytes.
+         */
+        void consume(size_t count)
+        {
+            head = (head + count) % CAPACITY;
+            size -= count;
+        }
+
+    public:
+        /**
+         * @brief Returns the number of bytes that can be fed without overwriting unparsed bytes.
+         * @return The free space of the ring buffer.
+         */
+        size_t space(void) const { return CAPACITY - size; }
+
+        /**
+         * @brief Returns the number of bytes skipped to resynchronize since the last reset.
+         * @return The number of bytes.
+         */
+        uint32_t getSkipped(void) const { return skipped; }
+
+        /**
+         * @brief Returns the number of packets failing the CRC since the last reset, they are skipped as well.
+         * @return The number of packets.
+         */
+        uint32_t getCorrupted(void) const { return corrupted; }
+
+        /**
+         * @brief Appends received bytes to the ring buffer.
+         * @param data The bytes.
+         * @param count The number of bytes.
+         * @return The number of bytes taken, less than count if the ring buffer is full.
+         */
+        size_t feed(const uint8_t *data, size_t count)
+        {
+            if (count > space())
+            {
+                count = space();
+            }
+
+            for (size_t i = 0; i < count; i++)
+            {
+                ring[(head + size + i) % CAPACITY] = data[i];
+            }
+            size += count;
+
+            return count;
+        }
+
+        /**
+         * @brief Extracts the next valid packet, skipping the bytes that do not start one.
+         * @param header The header of the packet.
+         * @param payload The frame of PAYLOAD_SIZE bytes, only written if a packet was found.
+         * @return true if a packet was found, false if more bytes are needed.
+         */
+        bool next(Header &header, uint8_t *payload)
+        {
+            uint8_t packet[PACKET_SIZE];
+
+            while (size > 0)
+            {
+                if (ring[head] != SYNC[0])
+                {
+                    consume(1);
+                    skipped++;
+                    continue;
+                }
+
+                size_t count = (size < static_cast<size_t>(PACKET_SIZE)) ? size : PACKET_SIZE;
+                for (size_t i = 0; i < count; i++)
+                {
+                    packet[i] = ring[(head + i) % CAPACITY];
+                }
+
+                Result result = decode(packet, count, header, payload);
+                if (result == Result::Ok)
+                {
+                    consume(PACKET_SIZE);
+                    return true;
+                }
+                if (result == Result::Incomplete)
+                {
+                    return false;
+                }
+
+                consume(1); // Not a packet, hunt for the next sync marker
+                skipped++;
+                corrupted += (result == Result::BadCrc) ? 1 : 0;
+            }
+
+            return false;
+        }
+
+        /**
+         * @brief Discards the bytes not parsed yet, e.g. when the port is reopened.
+         */
+        void reset(void)
+        {
+            head = 0;
+            size = 0;
+            skipped = 0;
+            corrupted = 0;
+        }
+    };
+}
+
+#endif // PROTOCOL_H
@@ -0,0 +1,80 @@
+/**
+ * @file seqlock.h
+ * @brief This file contains the declaration of the SeqLock class which shares a frame between two threads without a mutex.
+ *
+ * The writer bumps a sequence counter to an odd value, copies the data and bumps it back to an even value.
+ * The reader copies the data and retries if the counter was odd or changed meanwhile, so it never sees a torn frame.
+ * Neither side ever blocks, there must be only one writer at a time.
+ */
+#ifndef SEQLOCK_H
+#define SEQLOCK_H
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+/**
+ * @brief The SeqLock class holds a value written by a single thread and read by any number of threads.
+ * @tparam T The type of the value, it must be trivially copyable.
+ */
+template <typename T>
+class SeqLock
+{
+    static_assert(std::is_trivially_copyable_v<T>, "SeqLock requires a trivially copyable type");
+
+    std::atomic<uint32_t> sequence{0};     /**< The sequence counter, odd while a write is in progress. */
+    std::atomic<uint8_t> data[sizeof(T)]{}; /**< The bytes of the value, accessed relaxed between the fences. */
+
+public:
+    /**
+     * @brief Stores a new value, must only be called by the writer thread.
+     * @param value The new value.
+     */
+    void store(const T &value)
+    {
+        uint8_t bytes[sizeof(T)];
+        std::memcpy(bytes, &value, sizeof(T));
+
+        uint32_t seq = sequence.load(std::memory_order_relaxed);
+        sequence.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        for (size_t i = 0; i < sizeof(T); i++)
+        {
+            data[i].store(bytes[i], std::memory_order_relaxed);
+        }
+
+        sequence.store(seq + 2, std::memory_order_release);
+    }
+
+    /**
+     * @brief Loads a consistent copy of the value, retries while a write is in progress.
+     * @return The value.
+     */
+    T load(void) const
+    {
+        uint8_t bytes[sizeof(T)];
+        uint32_t before;
+        uint32_t after;
+
+        do
+        {
+            before = sequence.load(std::memory_order_acquire);
+
+            for (size_t i = 0; i < sizeof(T); i++)
+            {
+                bytes[i] = data[i].load(std::memory_order_relaxed);
+            }
+
+            std::atomic_thread_fence(std::memory_order_acquire);
+            after = sequence.load(std::memory_order_relaxed);
+        } while ((before & 1) || (before != after));
+
+        T value;
+        std::memcpy(&value, bytes, sizeof(T));
+        return value;
+    }
+};
+
+#endif // SEQLOCK_H
@@ -16,6 +16,8 @@ namespace Setting
             constexpr int Height{200}; /**<The height of the server window*/
 
         }
+
+        constexpr int MAX_QUEUE{16}; /**<The maximum number of frames queued for a slow client*/
     }
     namespace Client
     {
@@ -24,48 +26,65 @@ namespace Setting
             constexpr int Width{800};  /**<The width of the client window*/
             constexpr int Height{560}; /**<The height of the client window*/
         }
+
+        constexpr int MAX_FPS{60}; /**<The default maximum number of canvas refreshes per second, see --max-fps*/
+
+        constexpr int OVERLAY_PERIOD{500}; /**<The minimum time between two updates of the latency overlay in milliseconds*/
+
+        constexpr int BACKOFF_MIN{100};  /**<The delay before the first reconnection attempt in milliseconds*/
+        constexpr int BACKOFF_MAX{5000}; /**<The maximum delay between two reconnection attempts in milliseconds*/
+
+        constexpr int RECORD_CAPACITY{1 << 20}; /**<The number of frames a recording holds, 24 MiB*/
     }
 
     constexpr int INTERVAL{50}; /**<The interval of the timer in milliseconds*/
 
+    constexpr int HEARTBEAT{500};         /**<The maximum time between two frames in milliseconds, frames are otherwise only sent on change*/
+    constexpr int TIMEOUT{HEARTBEAT * 2}; /**<The time without any frame after which the connection is considered lost*/
+
     namespace Signal
     {
         namespace Speed
         {
-            constexpr int MIN{0};    /**<The minimum speed value*/
-            constexpr int MAX{240};  /**<The maximum speed value*/
-            constexpr int START{0};  /**<The start bit of the speed signal*/
-            constexpr int LENGTH{8}; /**<The length of the speed signal*/
+            constexpr int MIN{0};                   /**<The minimum speed value*/
+            constexpr int MAX{240};                 /**<The maximum speed value*/
+            constexpr int START{0};                 /**<The start bit of the speed signal*/
+            constexpr int LENGTH{8};                /**<The length of the speed signal*/
+            constexpr int STALE{HEARTBEAT * 3 / 2}; /**<The time without any frame after which the speed is shown as stale in milliseconds*/
         }
         namespace Temperature
         {
-            constexpr int MIN{-60};  /**<The minimum temperature value*/
-            constexpr int MAX{60};   /**<The maximum temperature value*/
-            constexpr int START{8};  /**<The start bit of the temperature signal*/
-            constexpr int LENGTH{7}; /**<The length of the temperature signal*/
+            constexpr int MIN{-60};       /**<The minimum temperature value*/
+            constexpr int MAX{60};        /**<The maximum temperature value*/
+            constexpr int START{8};       /**<The start bit of the temperature signal*/
+            constexpr int LENGTH{7};      /**<The length of the temperature signal*/
+            constexpr int STALE{TIMEOUT}; /**<The time without any frame after which the temperature is shown as stale in milliseconds*/
         }
         namespace BatteryLevel
         {
-            constexpr int MIN{0};    /**<The minimum battery level value*/
-            constexpr int MAX{100};  /**<The maximum battery level value*/
-            constexpr int START{15}; /**<The start bit of the battery level signal*/
-            constexpr int LENGTH{7}; /**<The length of the battery level signal*/
+            constexpr int MIN{0};         /**<The minimum battery level value*/
+            constexpr int MAX{100};       /**<The maximum battery level value*/
+            constexpr int START{15};      /**<The start bit of the battery level signal*/
+            constexpr int LENGTH{7};      /**<The length of the battery level signal*/
+            constexpr int STALE{TIMEOUT}; /**<The time without any frame after which the battery level is shown as stale in milliseconds*/
         }
         namespace Light
         {
             namespace Left
             {
-                constexpr int MIN{0};    /**<The minimum light value*/
-                constexpr int MAX{1};    /**<The maximum light value*/
-                constexpr int START{22}; /**<The start bit of the light signal*/
-                constexpr int LENGTH{1}; /**<The length of the light signal*/
+                constexpr int MIN{0};                   /**<The minimum light value*/
+                constexpr int MAX{1};                   /**<The maximum light value*/
+                constexpr int START{22};                /**<The start bit of the light signal*/
+                constexpr int LENGTH{1};                /**<The length of the light signal*/
+                constexpr int STALE{HEARTBEAT * 3 / 2}; /**<The time without any frame after which the light is shown as stale in milliseconds*/
             }
             namespace Right
             {
-                constexpr int MIN{0};    /**<The minimum light value*/
-                constexpr int MAX{1};    /**<The maximum light value*/
-                constexpr int START{23}; /**<The start bit of the light signal*/
-                constexpr int LENGTH{1}; /**<The length of the light signal*/
+                constexpr int MIN{0};                   /**<The minimum light value*/
+                constexpr int MAX{1};                   /**<The maximum light value*/
+                constexpr int START{23};                /**<The start bit of the light signal*/
+                constexpr int LENGTH{1};                /**<The length of the light signal*/
+                constexpr int STALE{HEARTBEAT * 3 / 2}; /**<The time without any frame after which the light is shown as stale in milliseconds*/
             }
 
         }
@@ -74,13 +93,23 @@ namespace Setting
         constexpr int BYTE_LEN{8}; /**<The length of a byte*/
     }
 
-#ifdef UARTCOM
     namespace UART_Connection
     {
         constexpr int BAUDRATE{115200};         /**<The baudrate of the UART connection*/
         constexpr char PORT[] = "/dev/ttyUSB0"; /**<The port of the UART connection*/
     }
-#else
+    namespace udp_connection
+    {
+        constexpr int PORT{15046};                /**<The port of the UDP connection*/
+        constexpr char GROUP[] = "239.255.0.45";  /**<The address the frames are sent to, a multicast group or a unicast address*/
+        constexpr char INTERFACE[] = "127.0.0.1"; /**<The address of the interface used for multicast, the loopback keeps the frames on the host*/
+        constexpr int TTL{1};                     /**<The number of hops a multicast frame may travel*/
+    }
+    namespace shm_connection
+    {
+        constexpr char NAME[] = "/speedometer"; /**<The name of the shared memory object*/
+        constexpr int CAPACITY{64};             /**<The number of packets the shared memory ring holds*/
+    }
     namespace tcp_connection
     {
         namespace tcp_port
@@ -92,6 +121,5 @@ namespace Setting
             constexpr char IP[] = "127.0.0.1"; /**<The IP of the TCP connection*/
         }
     }
-#endif // UARTCOM
 }
 #endif // SETTING_H
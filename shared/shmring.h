@@ -0,0 +1,158 @@
+/**
+ * @file shmring.h
+ * @brief This file contains the declaration of the ShmRing namespace which hands packets over through POSIX shared memory.
+ *
+ * The server maps a Region holding a ring of packet slots, each slot is a SeqLock so a reader never sees a torn packet.
+ * The writer stores the packet in the next slot, advances the head and rings the doorbell, a futex word the readers
+ * sleep on. The futex is only woken when a reader waits, so a packet costs no system call while the readers are busy.
+ * Any number of clients can read the ring, each one keeps its own position and detects an overrun through the
+ * sequence number of the packets. The atomics are lock-free, so they work across processes.
+ */
+#ifndef SHMRING_H
+#define SHMRING_H
+
+#include <atomic>
+#include <cerrno>
+#include <climits>
+#include <cstdint>
+#include <ctime>
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include "setting.h"
+#include "seqlock.h"
+#include "protocol.h"
+
+namespace ShmRing
+{
+    constexpr uint32_t MAGIC{0x53504432};                            /**<Marks a region that is fully initialized, "SPD2" since the packets carry the age*/
+    constexpr uint64_t CAPACITY{Setting::shm_connection::CAPACITY}; /**<The number of packets the ring holds*/
+
+    static_assert(std::atomic<uint64_t>::is_always_lock_free, "The ring needs lock-free atomics to be shared across processes");
+    static_assert(std::atomic<uint32_t>::is_always_lock_free, "The ring needs lock-free atomics to be shared across processes");
+
+    /**
+     * @brief The layout of the shared memory object.
+     */
+    struct Region
+    {
+        std::atomic<uint32_t> magic;               /**<MAGIC once the region is initialized*/
+        std::atomic<uint32_t> doorbell;            /**<The futex word, incremented for every packet*/
+        std::atomic<uint32_t> waiters;             /**<The number of readers sleeping on the doorbell*/
+        std::atomic<uint64_t> head;                /**<The number of packets written so far*/
+        SeqLock<Protocol::Packet> slots[CAPACITY]; /**<The packets, packet n lives in slot n % CAPACITY*/
+    };
+
+    /**
+     * @brief Wakes up every reader sleeping on the doorbell.
+     * @param region The region.
+     */
+    inline void wake(Region &region)
+    {
+        syscall(SYS_futex, &region.doorbell, FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+    }
+
+    /**
+     * @brief Sleeps until the doorbell rings, unless it already rang since it was read.
+     * @param region The region.
+     * @param bell The value of the doorbell read before checking the head.
+     * @param timeout The maximum time to sleep in milliseconds.
+     * @return false if the timeout expired, true otherwise.
+     */
+    inline bool wait(Region &region, uint32_t bell, int timeout)
+    {
+        timespec duration{timeout / 1000, (timeout % 1000) * 1000000L};
+
+        region.waiters.fetch_add(1);
+        long result = syscall(SYS_futex, &region.doorbell, FUTEX_WAIT, bell, &duration, nullptr, 0);
+        int error = errno;
+        region.waiters.fetch_sub(1);
+
+        return (result == 0) || (error != ETIMEDOUT);
+    }
+
+    /**
+     * @brief Appends a packet to the ring and rings the doorbell, the writers must be serialized.
+     * @param region The region.
+     * @param frame The frame, wrapped in a packet whose sequence number is its position in the ring.
+     * @param changed The monotonic time the frame last changed in microseconds.
+     */
+    inline void push(Region &region, const uint8_t *frame, uint64_t changed)
+    {
+        uint64_t head = region.head.load(std::memory_order_relaxed);
+        uint64_t now = Protocol::now();
+        Protocol::Packet packet;
+
+        Protocol::encode(frame, static_cast<uint32_t>(head), now, Protocol::age(changed, now), packet);
+        region.slots[head % CAPACITY].store(packet);
+        region.head.store(head + 1, std::memory_order_release);
+
+        region.doorbell.fetch_add(1);
+        if (region.waiters.load() > 0)
+        {
+            wake(region);
+        }
+    }
+
+    /**
+     * @brief Maps the shared memory object.
+     * @param name The name of the object, starting with a slash.
+     * @param create True for the writer, it replaces any existing object with a new one.
+     * @return The region, or nullptr if the object does not exist or is not initialized yet.
+     */
+    inline Region *map(const char *name, bool create)
+    {
+        if (create)
+        {
+            shm_unlink(name); // Readers still mapping a previous object time out and map the new one
+        }
+
+        int fd = create ? shm_open(name, O_CREAT | O_EXCL | O_RDWR | O_CLOEXEC, 0600) : shm_open(name, O_RDWR | O_CLOEXEC, 0);
+        if (fd == -1)
+        {
+            return nullptr;
+        }
+
+        struct stat info{};
+        if ((create && (0 != ftruncate(fd, sizeof(Region)))) ||
+            (0 != fstat(fd, &info)) || (info.st_size < static_cast<off_t>(sizeof(Region))))
+        {
+            close(fd);
+            return nullptr;
+        }
+
+        void *address = mmap(nullptr, sizeof(Region), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        close(fd);
+        if (address == MAP_FAILED)
+        {
+            return nullptr;
+        }
+
+        Region *region = static_cast<Region *>(address);
+        if (create)
+        {
+            region->magic.store(MAGIC, std::memory_order_release); // The object is zero-filled, the rest is ready
+        }
+        else if (region->magic.load(std::memory_order_acquire) != MAGIC)
+        {
+            munmap(address, sizeof(Region));
+            return nullptr;
+        }
+
+        return region;
+    }
+
+    /**
+     * @brief Unmaps the region.
+     * @param region The region.
+     */
+    inline void unmap(Region *region)
+    {
+        munmap(region, sizeof(Region));
+    }
+}
+
+#endif // SHMRING_H
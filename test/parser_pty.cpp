@@ -0,0 +1,198 @@
+/**
+ * @file parser_pty.cpp
+ * @brief Tests the Protocol::Parser on a byte stream read from a pseudo-terminal, the stand-in of the serial port.
+ *
+ * Every case writes packets into the master side of a pty, split into chunks of a few bytes and possibly damaged,
+ * and feeds whatever the slave side returns to a parser, as the UARTService of the client does with the serial port.
+ * The frames that come out are compared with the frames expected, the test exits with 1 if any case fails.
+ */
+#include <pty.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+#include <vector>
+#include "protocol.h"
+
+namespace
+{
+    using Bytes = std::vector<uint8_t>;
+
+    constexpr int READ_TIMEOUT{200}; /**<The time without any byte after which the stream is considered complete in milliseconds*/
+
+    /**
+     * @brief Returns a packet around a frame.
+     * @param sequence The sequence number, also the first byte of the frame.
+     * @param second The second byte of the frame.
+     * @param third The third byte of the frame.
+     * @return The bytes of the packet.
+     */
+    Bytes packet(uint32_t sequence, uint8_t second = 0, uint8_t third = 0)
+    {
+        const uint8_t frame[Protocol::PAYLOAD_SIZE]{static_cast<uint8_t>(sequence), second, third};
+        Protocol::Packet packet;
+        Protocol::encode(frame, sequence, Protocol::now(), 0, packet);
+        return Bytes(packet.begin(), packet.end());
+    }
+
+    /**
+     * @brief Appends bytes to a stream.
+     * @param stream The stream.
+     * @param bytes The bytes.
+     */
+    void append(Bytes &stream, const Bytes &bytes)
+    {
+        stream.insert(stream.end(), bytes.begin(), bytes.end());
+    }
+
+    /**
+     * @brief Writes a stream into the master side of a pty in chunks and parses what the slave side reads.
+     * @param stream The bytes written.
+     * @param chunk The size of the chunks, each one is written on its own so the reads are split.
+     * @param corrupted The number of packets failing the CRC, set from the parser.
+     * @return The sequence numbers of the packets the parser extracted, in order.
+     */
+    std::vector<uint32_t> transfer(const Bytes &stream, size_t chunk, uint32_t &corrupted)
+    {
+        std::vector<uint32_t> sequences;
+        int master{-1};
+        int slave{-1};
+        if (0 != openpty(&master, &slave, nullptr, nullptr, nullptr))
+        {
+            std::perror("openpty");
+            return sequences;
+        }
+
+        termios raw{};
+        tcgetattr(slave, &raw);
+        cfmakeraw(&raw); // The bytes are binary, no echo nor line discipline
+        tcsetattr(slave, TCSANOW, &raw);
+
+        std::thread writer{[&]
+                           {
+                               for (size_t offset = 0; offset < stream.size(); offset += chunk)
+                               {
+                                   size_t count = std::min(chunk, stream.size() - offset);
+                                   if (static_cast<ssize_t>(count) != write(master, stream.data() + offset, count))
+                                   {
+                                       return;
+                                   }
+                                   std::this_thread::sleep_for(std::chrono::microseconds(200));
+                               }
+                           }};
+
+        Protocol::Parser parser;
+        Protocol::Header header;
+        uint8_t frame[Protocol::PAYLOAD_SIZE];
+        uint8_t buffer[64];
+        pollfd readable{slave, POLLIN, 0};
+
+        while (poll(&readable, 1, READ_TIMEOUT) > 0)
+        {
+            size_t wanted = std::min(sizeof(buffer), parser.space());
+            ssize_t n = read(slave, buffer, wanted);
+            if (n <= 0)
+            {
+                break;
+            }
+            parser.feed(buffer, static_cast<size_t>(n));
+
+            while (parser.next(header, frame))
+            {
+                if (frame[0] != static_cast<uint8_t>(header.sequence))
+                {
+                    std::printf("  packet %u carries the frame of another packet\n", header.sequence);
+                }
+                sequences.push_back(header.sequence);
+            }
+        }
+
+        writer.join();
+        corrupted = parser.getCorrupted();
+        close(slave);
+        close(master);
+        return sequences;
+    }
+
+    /**
+     * @brief Runs a case and prints its result.
+     * @param name The name of the case.
+     * @param stream The bytes written.
+     * @param chunk The size of the chunks written.
+     * @param expected The sequence numbers the parser must extract.
+     * @param corrupted The number of packets that must fail the CRC.
+     * @return true if the parser extracted exactly the expected packets.
+     */
+    bool check(const char *name, const Bytes &stream, size_t chunk, const std::vector<uint32_t> &expected, uint32_t corrupted)
+    {
+        uint32_t counted{0};
+        std::vector<uint32_t> sequences = transfer(stream, chunk, counted);
+        bool passed = (sequences == expected) && (counted == corrupted);
+
+        std::printf("%s %s: %zu of %zu packets, %u corrupted\n", passed ? "PASS" : "FAIL", name, sequences.size(),
+                    expected.size(), counted);
+        return passed;
+    }
+}
+
+int main(void)
+{
+    bool passed{true};
+
+    // Packets split across reads at every possible offset
+    for (size_t chunk : {1, 2, 7, 24, 26})
+    {
+        Bytes stream;
+        std::vector<uint32_t> expected;
+        for (uint32_t i = 0; i < 20; i++)
+        {
+            append(stream, packet(i));
+            expected.push_back(i);
+        }
+        char name[32];
+        std::snprintf(name, sizeof(name), "split by %zu", chunk);
+        passed &= check(name, stream, chunk, expected, 0);
+    }
+
+    // A corrupted byte in the payload, only that packet is lost
+    {
+        Bytes stream;
+        for (uint32_t i = 0; i < 5; i++)
+        {
+            Bytes bytes = packet(i);
+            if (i == 2)
+            {
+                bytes[Protocol::HEADER_SIZE + 1] ^= 0x40;
+            }
+            append(stream, bytes);
+        }
+        passed &= check("corrupted payload", stream, 5, {0, 1, 3, 4}, 1);
+    }
+
+    // Lost bytes, the truncated packet fails the CRC and the parser resynchronizes on the next sync marker
+    {
+        Bytes stream{0x00, 0x5A, 0xFF};
+        append(stream, packet(0));
+        Bytes truncated = packet(1);
+        truncated.resize(11);
+        append(stream, truncated);
+        append(stream, packet(2));
+        append(stream, packet(3));
+        passed &= check("lost bytes", stream, 3, {0, 2, 3}, 1);
+    }
+
+    // A sync marker inside the payload of a packet whose own marker was lost, it must not start a packet
+    {
+        Bytes stream = packet(0);
+        Bytes headless = packet(1, Protocol::SYNC[0], Protocol::SYNC[1]);
+        headless.erase(headless.begin());
+        append(stream, headless);
+        append(stream, packet(2, Protocol::SYNC[0], Protocol::SYNC[1]));
+        append(stream, packet(3));
+        passed &= check("sync marker in payload", stream, 4, {0, 2, 3}, 0);
+    }
+
+    return passed ? 0 : 1;
+}
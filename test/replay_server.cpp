@@ -0,0 +1,171 @@
+/**
+ * @file replay_server.cpp
+ * @brief Tests that a replay over TCP delivers every frame of the recording to a client, in order.
+ *
+ * A recording is written whose frames carry their own index, then streamed as fast as possible through a TCPService
+ * on the loopback while a raw socket reads the packets. The client must see every index exactly in order, only
+ * repeated by heartbeats, and the last one must arrive although the service is destroyed as soon as the replay returns.
+ */
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <unistd.h>
+#include <poll.h>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include "framelog.h"
+#include "protocol.h"
+#include "replay.h"
+#include "tcpservice.h"
+
+namespace
+{
+    constexpr uint32_t FRAMES{5000};  /**<The number of frames of the recording*/
+    constexpr int READ_TIMEOUT{2000}; /**<The time without any byte after which the client gives up in milliseconds*/
+
+    /**
+     * @brief Returns a port of the loopback that is free right now.
+     * @return The port, 0 if none could be found.
+     */
+    int freePort(void)
+    {
+        int fd = socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in address{};
+        socklen_t length{sizeof(address)};
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+        int port{0};
+        if ((0 == bind(fd, (const struct sockaddr *)&address, sizeof(address))) &&
+            (0 == getsockname(fd, (struct sockaddr *)&address, &length)))
+        {
+            port = ntohs(address.sin_port);
+        }
+        close(fd);
+        return port;
+    }
+
+    /**
+     * @brief Connects to the server and checks the frames of every packet until the connection is closed.
+     * @param port The port of the server.
+     * @param next The index of the next frame expected, FRAMES + 1 once all were received.
+     * @param errors The number of frames missing or out of order.
+     */
+    void receive(int port, uint32_t &next, uint32_t &errors)
+    {
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_port = htons(port);
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+        int fd{-1};
+        for (int attempt = 0; attempt < 100; attempt++) // The service may not listen yet
+        {
+            fd = socket(AF_INET, SOCK_STREAM, 0);
+            if (0 == ::connect(fd, (const struct sockaddr *)&address, sizeof(address)))
+            {
+                break;
+            }
+            close(fd);
+            fd = -1;
+            std::this_thread::sleep_for(std::chrono::milliseconds(Setting::INTERVAL / 10));
+        }
+        if (fd == -1)
+        {
+            std::printf("  cannot connect to port %d\n", port);
+            return;
+        }
+
+        Protocol::Parser parser;
+        Protocol::Header header;
+        uint8_t frame[Protocol::PAYLOAD_SIZE];
+        uint32_t last{0};
+        pollfd readable{fd, POLLIN, 0};
+
+        while (poll(&readable, 1, READ_TIMEOUT) > 0)
+        {
+            uint8_t buffer[1024];
+            ssize_t n = recv(fd, buffer, std::min(sizeof(buffer), parser.space()), 0);
+            if (n <= 0)
+            {
+                break; // The service is destroyed
+            }
+            parser.feed(buffer, static_cast<size_t>(n));
+
+            while (parser.next(header, frame))
+            {
+                uint32_t index = frame[0] | (frame[1] << 8) | (frame[2] << 16);
+                if (index == last)
+                {
+                    continue; // The state before the replay or a heartbeat
+                }
+                if (index != next)
+                {
+                    std::printf("  frame %u received, %u expected\n", index, next);
+                    errors++;
+                }
+                next = index + 1;
+                last = index;
+            }
+        }
+
+        close(fd);
+    }
+}
+
+int main(void)
+{
+    char path[] = "/tmp/replay_testXXXXXX";
+    int fd = mkstemp(path);
+    if (fd == -1)
+    {
+        std::perror("mkstemp");
+        return 1;
+    }
+    close(fd);
+
+    {
+        FrameLog::Writer writer;
+        if (!writer.open(path, FRAMES))
+        {
+            std::printf("cannot create the recording %s\n", path);
+            return 1;
+        }
+        Protocol::Header header{};
+        for (uint32_t index = 1; index <= FRAMES; index++)
+        {
+            const uint8_t frame[Protocol::PAYLOAD_SIZE]{static_cast<uint8_t>(index), static_cast<uint8_t>(index >> 8),
+                                                        static_cast<uint8_t>(index >> 16)};
+            header.sequence = index;
+            writer.append(header, frame, index * 1000ULL);
+        }
+    }
+
+    Options options;
+    options.host = "127.0.0.1";
+    options.tcpPort = freePort();
+
+    uint32_t next{1};
+    uint32_t errors{0};
+    uint64_t sent{0};
+    std::thread client{receive, options.tcpPort, std::ref(next), std::ref(errors)};
+
+    {
+        TCPService service{options};
+        Replay replay{service, 0};
+        if (replay.open(path))
+        {
+            sent = replay.run();
+        }
+    } // Destroyed right away, the last frame must already be written
+
+    client.join();
+    unlink(path);
+
+    bool passed = (sent == FRAMES) && (next == FRAMES + 1) && (errors == 0);
+    std::printf("%s replay over tcp: %llu frames sent, last frame received %u, %u missing or out of order\n",
+                passed ? "PASS" : "FAIL", static_cast<unsigned long long>(sent), next - 1, errors);
+
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,119 @@
+/**
+ * @file seqlock_client.cpp
+ * @brief Stress test of the seqlock and of the buffer of the client COMService, fails if any read is torn.
+ *
+ * A writer thread stores frames whose three bytes are equal while the main thread reads them back for a while.
+ * A read mixing the bytes of two frames is torn, the test then prints the count and exits with 1, e.g.
+ * @code
+ * ctest --output-on-failure -R seqlock
+ * @endcode
+ */
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+#include "codec.h"
+#include "seqlock.h"
+#include "options.h"
+#include "comservice.h"
+
+namespace
+{
+    constexpr auto DURATION = std::chrono::milliseconds(300); /**<The time every check reads for*/
+
+    static_assert(Signal::All::MASK == Codec::mask(Setting::Signal::BUFSIZE * Setting::Signal::BYTE_LEN),
+                  "The snapshot check needs every bit of the frame to belong to a signal");
+
+    /**
+     * @brief A client service without a transport, the test publishes the frames itself as the I/O thread would.
+     */
+    class Probe : public COMService
+    {
+        void run(void) override {}
+
+    public:
+        explicit Probe(const Options &options) : COMService{options} {}
+
+        using COMService::publish;
+    };
+
+    /**
+     * @brief Runs a writer thread against reads on the calling thread.
+     * @param name The name of the check, printed with its result.
+     * @param write Stores the frame {value, value, value}, called from the writer thread only.
+     * @param torn Reads a frame and tells whether it is torn.
+     * @return true if no read was torn.
+     */
+    template <typename Write, typename Torn>
+    bool stress(const char *name, Write write, Torn torn)
+    {
+        std::atomic<bool> end{false};
+        uint64_t writes{0};
+
+        std::thread writer{[&]
+                           {
+                               for (uint8_t value = 0; !end; value++, writes++)
+                               {
+                                   write(Codec::Frame{value, value, value});
+                               }
+                           }};
+
+        uint64_t reads{0};
+        uint64_t failures{0};
+        auto start = std::chrono::steady_clock::now();
+        while (std::chrono::steady_clock::now() - start < DURATION)
+        {
+            failures += torn() ? 1 : 0;
+            reads++;
+        }
+        end = true;
+        writer.join();
+
+        std::printf("%s: %llu reads, %llu writes, %llu torn\n", name, static_cast<unsigned long long>(reads),
+                    static_cast<unsigned long long>(writes), static_cast<unsigned long long>(failures));
+        return (failures == 0) && (writes > 0);
+    }
+
+    /**
+     * @brief Tells whether the bytes of a frame differ.
+     * @param frame The frame.
+     * @return true if the frame mixes two writes.
+     */
+    bool mixed(const Codec::Frame &frame)
+    {
+        return (frame[0] != frame[1]) || (frame[1] != frame[2]);
+    }
+}
+
+int main(void)
+{
+    bool passed{true};
+
+    SeqLock<Codec::Frame> lock;
+    passed &= stress("seqlock", [&lock](const Codec::Frame &frame)
+                     { lock.store(frame); },
+                     [&lock]
+                     { return mixed(lock.load()); });
+
+    Options options;
+    Probe probe{options};
+    passed &= stress("client.snapshot", [&probe](const Codec::Frame &frame)
+                     { probe.publish(frame); },
+                     [&probe]
+                     {
+                         // Every bit of the frame belongs to a signal, so the snapshot gives the whole frame back
+                         Snapshot snap = probe.snapshot();
+                         Codec::Word word{0};
+                         word = Codec::set<Signal::Speed>(word, snap.speed);
+                         word = Codec::set<Signal::Temperature>(word, snap.temperature);
+                         word = Codec::set<Signal::BatteryLevel>(word, snap.batteryLevel);
+                         word = Codec::set<Signal::LightLeft>(word, snap.lightLeft);
+                         word = Codec::set<Signal::LightRight>(word, snap.lightRight);
+
+                         Codec::Frame frame;
+                         Codec::store(word, frame.data());
+                         return mixed(frame);
+                     });
+
+    return passed ? 0 : 1;
+}
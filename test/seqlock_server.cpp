@@ -0,0 +1,65 @@
+/**
+ * @file seqlock_server.cpp
+ * @brief Stress test of the buffer of the server COMService, fails if any packet carries a torn frame.
+ *
+ * The main thread replaces the frame with frames whose three bytes are equal, as the replay does, while a reader
+ * thread wraps it in packets as the I/O thread does. A packet mixing the bytes of two frames is torn.
+ */
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+#include "codec.h"
+#include "protocol.h"
+#include "comservice.h"
+
+namespace
+{
+    constexpr auto DURATION = std::chrono::milliseconds(300); /**<The time the reader packs for*/
+
+    /**
+     * @brief A server service without a transport, the test packs the frames itself as the I/O thread would.
+     */
+    class Probe : public COMService
+    {
+        void run(void) override {}
+
+    public:
+        using COMService::pack;
+    };
+}
+
+int main(void)
+{
+    Probe probe;
+    std::atomic<bool> end{false};
+    uint64_t reads{0};
+    uint64_t torn{0};
+
+    std::thread reader{[&]
+                       {
+                           Protocol::Packet packet;
+                           Protocol::Header header;
+                           Codec::Frame frame;
+                           for (uint32_t sequence = 0; !end; sequence++, reads++)
+                           {
+                               probe.pack(sequence, packet);
+                               bool valid = (Protocol::decode(packet.data(), packet.size(), header, frame.data()) == Protocol::Result::Ok);
+                               torn += (!valid || (frame[0] != frame[1]) || (frame[1] != frame[2])) ? 1 : 0;
+                           }
+                       }};
+
+    uint64_t writes{0};
+    auto start = std::chrono::steady_clock::now();
+    for (uint8_t value = 0; std::chrono::steady_clock::now() - start < DURATION; value++, writes++)
+    {
+        probe.setFrame(Codec::Frame{value, value, value});
+    }
+    end = true;
+    reader.join();
+
+    std::printf("server.pack: %llu reads, %llu writes, %llu torn\n", static_cast<unsigned long long>(reads),
+                static_cast<unsigned long long>(writes), static_cast<unsigned long long>(torn));
+
+    return ((torn == 0) && (reads > 0)) ? 0 : 1;
+}